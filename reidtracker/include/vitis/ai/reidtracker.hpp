@@ -23,11 +23,14 @@
  */
 #pragma once
 
+#include <future>
 #include <memory>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
+#include <string>
 #include <tuple>
+#include <vector>
 
 namespace vitis {
 namespace ai {
@@ -44,6 +47,54 @@ class ReidTracker {
   /// OutputCharact: gid, bbox, score, label, local_id
   typedef std::tuple<uint64_t, cv::Rect_<float>, float, int, int> OutputCharact;
   typedef std::tuple<std::array<int, 4>, std::array<int, 3>> SpecifiedCfg;
+  /// Detection: plain record for the span based track(). feat points to
+  /// feat_dim floats owned by the caller, it must stay valid during the call.
+  struct Detection {
+    const float *feat;
+    int feat_dim;
+    cv::Rect_<float> bbox;
+    float score;
+    int label;
+    int local_id;
+  };
+  /// DetectionResult: what became of one Detection of the span based
+  /// track(). gid and bbox (the tracked box) are those of the track the
+  /// detection was assigned to; gid is 0 unless the state is TRACKED.
+  struct DetectionResult {
+    enum State {
+      REJECTED = -1,  ///< invalid box or score, not tracked
+      TENTATIVE = 0,  ///< assigned to a track that is not reported yet
+      TRACKED = 1     ///< assigned to a reported track
+    };
+    uint64_t gid;
+    cv::Rect_<float> bbox;
+    State state;
+  };
+  /// TrackEvent: a lifecycle transition of a track, see PopEvents().
+  /// local_id is that of the detection causing the event, -1 if none.
+  struct TrackEvent {
+    enum Type {
+      CREATED,       ///< tentative track started, it has no gid yet
+      CONFIRMED,     ///< first reported, the gid is assigned here
+      LOST,          ///< a confirmed track missed a detection frame
+      REIDENTIFIED,  ///< a lost track matched a detection again
+      REMOVED        ///< track deleted, gid 0 if it was never confirmed
+    };
+    Type type;
+    uint64_t frame_id;
+    uint64_t gid;
+    int local_id;
+  };
+  /// TrackLockStats: contention of setTrackLock(), times in microseconds.
+  /// Only calls that had to wait for a previous frame are contended, the
+  /// wait times are over those.
+  struct TrackLockStats {
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t timeouts;
+    double wait_avg;
+    double wait_max;
+  };
 
   /**
    *@enum TRACKER mode
@@ -58,7 +109,9 @@ class ReidTracker {
    * @brief Constructor function for creating ReidTracker instance.
    *
    * @param mode. see enum TRACKER mode defination
-   * @param cfg  Configure value. Please use default value.
+   * @param cfg  Configure value. Please use default value, or an all_region
+   * (first array) of {0, 0, 0, 0} to predict motion with a constant
+   * velocity Kalman filter instead of the linear regression.
    */
 
   static std::shared_ptr<ReidTracker> create(
@@ -76,11 +129,47 @@ class ReidTracker {
    */
   virtual std::vector<int> GetRemoveID() = 0;
 
+  /**
+   * @brief Function to drain the track lifecycle events, oldest first.
+   *
+   * Events are kept in a bounded ring (REID_TRACKER_EVENTS entries) which
+   * may be drained from another thread while tracking. When the ring is
+   * full new events are dropped.
+   *
+   * @param events Array receiving up to max_count events.
+   * @param dropped If not null, receives the number of events dropped so
+   * far.
+   *
+   * @return the number of events written.
+   */
+  virtual size_t PopEvents(TrackEvent *events, size_t max_count,
+                           uint64_t *dropped = nullptr) = 0;
+
   /**
    * @brief Function to clear the state of ReidTracker.
    */
   virtual void clear() = 0;
 
+  /**
+   * @brief Function to save the state periodically for a warm restart.
+   *
+   * Every period frames the tracks, their motion filters and features and
+   * the id counters are copied to a versioned binary image, which a
+   * background thread writes to path; tracking never waits for the file.
+   * A period of 0 stops after the last image is written. Call it from the
+   * thread that tracks.
+   */
+  virtual void setSnapshot(const std::string &path, int period) = 0;
+
+  /**
+   * @brief Function to restore the state saved by setSnapshot(), the tracks
+   * keep their global ids and new ids continue after them.
+   *
+   * @return false, leaving the tracker cleared, if the file is missing,
+   * damaged, or was written by another version or configuration.
+   */
+  virtual bool restoreSnapshot(const std::string &path) = 0;
+
   /**
    * @brief Function to patch the missing frame.
    *
@@ -108,6 +197,29 @@ class ReidTracker {
       std::vector<InputCharact> &input_characts, const bool is_detection,
       const bool is_normalized) = 0;
 
+  /**
+   * @brief Function to do the track on a read-only span of detections : only
+   * use in !MODE_MULTIDETS mode.
+   *
+   * Same as the track() above without copies: the detections are neither
+   * copied nor modified, and the results are written to output_characts,
+   * which is cleared first so its capacity is reused from frame to frame.
+   *
+   * @param frame_id The frame_id of the frame to track
+   * @param detections The detections of the frame, count records.
+   * @param count Number of detections.
+   * @param is_detection If this frame is detection frame ( or patch frame ).
+   * @param is_normalized If the bbox of input data is normalized.
+   * @param output_characts The result of the track, see track() above.
+   * @param detection_results If not null, count results written in the
+   * order of detections, so result k tells what became of detection k.
+   */
+  virtual void track(const uint64_t frame_id, const Detection *detections,
+                     size_t count, const bool is_detection,
+                     const bool is_normalized,
+                     std::vector<OutputCharact> &output_characts,
+                     DetectionResult *detection_results = nullptr) = 0;
+
   /**
    * @brief Function : only use in MODE_MULTIDETS mode.
    *    Notify the tracker that detection starts, only the thread with minimal
@@ -136,10 +248,12 @@ class ReidTracker {
   /**
    * @brief Function : only use in MODE_MULTIDETS mode.
    *    Add lock for tracking
+   *    The lock is handed over in frame_id order: the caller sleeps until
+   *    the frames before it are tracked or timed out, and is woken then.
    *
    * @param frame_id
    * @param timeout the time to stop getting the track lock. uint: ms
-   * @param interval the time interval to try getting the track lock. uint: ms
+   * @param interval unused, kept for compatibility. uint: ms
    *
    * @return false if fail to get the track lock
    */
@@ -154,6 +268,28 @@ class ReidTracker {
    */
   virtual bool releaseTrackLock(int frame_id) = 0;
 
+  /**
+   * @brief Function : only use in MODE_MULTIDETS mode.
+   *    contention of setTrackLock() so far
+   */
+  virtual TrackLockStats getTrackLockStats() = 0;
+
+  /**
+   * @brief Function : only use in MODE_MULTIDETS mode.
+   *  Prepare the track of a frame before taking the track lock: reject the
+   *  invalid detections and compare the features with those of the tracks
+   *  as of the last tracked frame. Runs concurrently with tracking, so the
+   *  detector threads spend less time under the lock; trackWithoutLock or
+   *  trackWithLock of the frame then only compares the tracks changed since.
+   *
+   * @param frame_id
+   * @param input_characts as passed to track later, the rejected ones are
+   * erased; it must not change until then.
+   * @return false if not in MODE_MULTIDETS mode.
+   */
+  virtual bool prepareTrack(const uint64_t frame_id,
+                            std::vector<InputCharact> &input_characts) = 0;
+
   /**
    * @brief Function : only use in MODE_MULTIDETS mode.
    *  Track without lock, need to handle the lock mannually in multi-thread
@@ -188,8 +324,9 @@ class ReidTracker {
       const bool is_detection = true, const bool is_normalized = true) = 0;
   /**
    * @brief Function : only use in MODE_MULTIDETS mode.
-   * Output the track results of un-detection frames, only the recent 100
-   * undet-frames will be kept
+   * Output the track results of un-detection frames, only the recent
+   * REID_TRACKER_UNDET_FRAMES (default 100) undet-frames will be kept, and
+   * each is output once
    *
    * @param frame_id
    * @return the output charact{global_id, tracked_bbox, score, label,
@@ -212,5 +349,81 @@ class ReidTracker {
   virtual void printUndetTracks() = 0;
 };
 
+/**
+ * @brief Owner of the trackers of several video streams.
+ *
+ * Each stream, keyed by an id chosen by the caller, has its own ReidTracker
+ * and frame counter. Updates are run by a fixed pool of worker threads, one
+ * update of a stream at a time and in submission order, so the streams of a
+ * multi camera process are tracked in parallel without one thread each.
+ */
+class ReidTrackerManager {
+ public:
+  /// StreamStats: latencies of the updates of one stream, in microseconds.
+  /// queue is the time from submission to the start of the update, update
+  /// the time spent in ReidTracker::track.
+  struct StreamStats {
+    uint64_t frames;   ///< updates completed
+    uint64_t pending;  ///< updates submitted but not completed
+    double queue_avg;
+    double queue_max;
+    double update_avg;
+    double update_max;
+  };
+
+  /**
+   * @brief Function to create a manager.
+   *
+   * @param workers Number of worker threads, 0 for one per core.
+   * @param mode, cfg Passed to ReidTracker::create() for every stream.
+   * MODE_MULTIDETS is not supported.
+   */
+  static std::shared_ptr<ReidTrackerManager> create(
+      int workers = 0, uint64_t mode = 0,
+      const ReidTracker::SpecifiedCfg &cfg = ReidTracker::SpecifiedCfg(
+          std::array<int, 4>({3, 3, 1, 1}), std::array<int, 3>({3, 2, 1})));
+  ReidTrackerManager();
+  ReidTrackerManager(const ReidTrackerManager &) = delete;
+  ReidTrackerManager &operator=(const ReidTrackerManager &) = delete;
+  /// Destructor, completes the submitted updates first.
+  virtual ~ReidTrackerManager();
+
+  /**
+   * @brief Function to get the tracker of a stream, which is created on
+   * first use. Do not call its track() while updates of the stream are
+   * pending.
+   */
+  virtual std::shared_ptr<ReidTracker> tracker(int stream_id) = 0;
+
+  /**
+   * @brief Function to remove a stream; its pending updates still complete.
+   *
+   * @return false if the stream does not exist.
+   */
+  virtual bool removeStream(int stream_id) = 0;
+
+  /**
+   * @brief Function to queue the track of the next frame of a stream, see
+   * the span based ReidTracker::track().
+   *
+   * The frame id is the frame counter of the stream, which starts at 1. The
+   * detections, the features they point to, output_characts and
+   * detection_results are borrowed until the returned future is ready.
+   *
+   * @return a future holding the frame id once the results are written.
+   */
+  virtual std::future<uint64_t> track(
+      int stream_id, const ReidTracker::Detection *detections, size_t count,
+      const bool is_detection, const bool is_normalized,
+      std::vector<ReidTracker::OutputCharact> &output_characts,
+      ReidTracker::DetectionResult *detection_results = nullptr) = 0;
+
+  /**
+   * @brief Function to get the latencies of a stream, all zero if the
+   * stream does not exist.
+   */
+  virtual StreamStats stats(int stream_id) = 0;
+};
+
 }  // namespace ai
 }  // namespace vitis
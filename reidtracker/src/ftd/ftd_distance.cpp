@@ -0,0 +1,495 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_distance.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace vitis {
+namespace ai {
+
+namespace {
+
+// Each SIMD backend provides a vector type, its lane count and the
+// load/fma/horizontal-sum primitives, plus the register tile (kMR rows of a
+// times kNR rows of b) that fits its register file without spilling.
+#if defined(__aarch64__)
+typedef float32x4_t vfloat;
+constexpr int kLanes = 4;
+constexpr int kMR = 4;
+constexpr int kNR = 4;
+inline vfloat VZero() { return vdupq_n_f32(0.f); }
+inline vfloat VLoad(const float *p) { return vld1q_f32(p); }
+inline vfloat VFma(vfloat acc, vfloat a, vfloat b) {
+  return vfmaq_f32(acc, a, b);
+}
+inline float VSum(vfloat v) { return vaddvq_f32(v); }
+#elif defined(__AVX__)
+typedef __m256 vfloat;
+constexpr int kLanes = 8;
+constexpr int kMR = 4;
+constexpr int kNR = 2;
+inline vfloat VZero() { return _mm256_setzero_ps(); }
+inline vfloat VLoad(const float *p) { return _mm256_loadu_ps(p); }
+inline vfloat VFma(vfloat acc, vfloat a, vfloat b) {
+#if defined(__FMA__)
+  return _mm256_fmadd_ps(a, b, acc);
+#else
+  return _mm256_add_ps(acc, _mm256_mul_ps(a, b));
+#endif
+}
+inline float VSum(vfloat v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+  return _mm_cvtss_f32(s);
+}
+#elif defined(__SSE2__)
+typedef __m128 vfloat;
+constexpr int kLanes = 4;
+constexpr int kMR = 4;
+constexpr int kNR = 2;
+inline vfloat VZero() { return _mm_setzero_ps(); }
+inline vfloat VLoad(const float *p) { return _mm_loadu_ps(p); }
+inline vfloat VFma(vfloat acc, vfloat a, vfloat b) {
+  return _mm_add_ps(acc, _mm_mul_ps(a, b));
+}
+inline float VSum(vfloat s) {
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+  return _mm_cvtss_f32(s);
+}
+#else
+typedef float vfloat;
+constexpr int kLanes = 1;
+constexpr int kMR = 1;
+constexpr int kNR = 1;
+inline vfloat VZero() { return 0.f; }
+inline vfloat VLoad(const float *p) { return *p; }
+inline vfloat VFma(vfloat acc, vfloat a, vfloat b) { return acc + a * b; }
+inline float VSum(vfloat v) { return v; }
+#endif
+
+// Rows of b processed per sweep over a; kBlockB * dim floats stay in L1.
+constexpr int kBlockB = 8;
+
+// The kernels below are templates on the feature dim: D > 0 is a dim fixed
+// at compile time, for which the loops have constant trip counts, unroll
+// and lose their tails; D = 0 is the generic version taking the runtime dim.
+// See FeatKernelsFor.
+
+// out[r * kNR + c] = dot(a row r, b row c) for a full kMR x kNR tile.
+template <int D>
+inline void DotTile(const float *a, int lda, const float *b, int ldb, int n,
+                    float *out) {
+  const int dim = D > 0 ? D : n;
+  vfloat acc[kMR][kNR];
+  for (int r = 0; r < kMR; ++r)
+    for (int c = 0; c < kNR; ++c) acc[r][c] = VZero();
+  int k = 0;
+#pragma GCC unroll 4
+  for (; k + kLanes <= dim; k += kLanes) {
+    vfloat vb[kNR];
+    for (int c = 0; c < kNR; ++c) vb[c] = VLoad(b + c * ldb + k);
+    for (int r = 0; r < kMR; ++r) {
+      vfloat va = VLoad(a + r * lda + k);
+      for (int c = 0; c < kNR; ++c) acc[r][c] = VFma(acc[r][c], va, vb[c]);
+    }
+  }
+  for (int r = 0; r < kMR; ++r) {
+    for (int c = 0; c < kNR; ++c) {
+      float sum = VSum(acc[r][c]);
+      if (D == 0 || D % kLanes != 0) {
+        for (int kk = k; kk < dim; ++kk) sum += a[r * lda + kk] * b[c * ldb + kk];
+      }
+      out[r * kNR + c] = sum;
+    }
+  }
+}
+
+// Portable IEEE half conversions, used for tails and when the target has no
+// conversion instructions.
+inline uint16_t FloatToHalf(float f) {
+  uint32_t x;
+  std::memcpy(&x, &f, sizeof(x));
+  uint32_t sign = (x >> 16) & 0x8000u;
+  uint32_t mant = x & 0x7fffffu;
+  int exp = (x >> 23) & 0xff;
+  if (exp == 0xff) return sign | 0x7c00u | (mant ? 0x200u : 0u);
+  int e = exp - 127 + 15;
+  if (e >= 0x1f) return sign | 0x7c00u;
+  if (e <= 0) {
+    // subnormal half, or zero
+    if (e < -10) return sign;
+    mant |= 0x800000u;
+    int shift = 14 - e;
+    uint32_t half = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t mid = 1u << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1))) half++;
+    return sign | half;
+  }
+  uint32_t half = ((uint32_t)e << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fffu;
+  // a carry out of the mantissa correctly bumps the exponent
+  if (rem > 0x1000u || (rem == 0x1000u && (half & 1))) half++;
+  return sign | half;
+}
+
+inline float HalfToFloat(uint16_t h) {
+  uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+  int exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ffu;
+  uint32_t x;
+  if (exp == 0x1f) {
+    x = sign | 0x7f800000u | (mant << 13);
+  } else if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else {
+      // normalize the subnormal
+      exp = 1;
+      while (!(mant & 0x400u)) {
+        mant <<= 1;
+        exp--;
+      }
+      x = sign | ((uint32_t)(exp + 127 - 15) << 23) | ((mant & 0x3ffu) << 13);
+    }
+  } else {
+    x = sign | ((uint32_t)(exp + 127 - 15) << 23) | (mant << 13);
+  }
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+template <int D>
+float Dot(const float *a, const float *b, int n) {
+  const int dim = D > 0 ? D : n;
+  vfloat acc0 = VZero(), acc1 = VZero();
+  int k = 0;
+#pragma GCC unroll 8
+  for (; k + 2 * kLanes <= dim; k += 2 * kLanes) {
+    acc0 = VFma(acc0, VLoad(a + k), VLoad(b + k));
+    acc1 = VFma(acc1, VLoad(a + k + kLanes), VLoad(b + k + kLanes));
+  }
+  for (; k + kLanes <= dim; k += kLanes) {
+    acc0 = VFma(acc0, VLoad(a + k), VLoad(b + k));
+  }
+  float sum = VSum(acc0) + VSum(acc1);
+  for (; k < dim; ++k) sum += a[k] * b[k];
+  return sum;
+}
+
+// Walks a x b in register tiles and hands every dot product to
+// out(i, j, dot).
+template <int D, class Out>
+inline void TileDots(const float *a, int na, int lda, const float *b, int nb,
+                     int ldb, int n, Out out) {
+  const int dim = D > 0 ? D : n;
+  float tile[kMR * kNR];
+  for (int jb = 0; jb < nb; jb += kBlockB) {
+    int jn = std::min(kBlockB, nb - jb);
+    const float *bb = b + jb * ldb;
+    for (int i = 0; i < na; i += kMR) {
+      int in = std::min(kMR, na - i);
+      int j = 0;
+      if (in == kMR) {
+        for (; j + kNR <= jn; j += kNR) {
+          DotTile<D>(a + i * lda, lda, bb + j * ldb, ldb, dim, tile);
+          for (int r = 0; r < kMR; ++r)
+            for (int c = 0; c < kNR; ++c)
+              out(i + r, jb + j + c, tile[r * kNR + c]);
+        }
+      }
+      for (int r = 0; r < in; ++r) {
+        for (int c = j; c < jn; ++c) {
+          out(i + r, jb + c, Dot<D>(a + (i + r) * lda, bb + c * ldb, dim));
+        }
+      }
+    }
+  }
+}
+
+template <int D>
+void DotMatrix(const float *a, int na, int lda, const float *b, int nb,
+               int ldb, int n, float *dot, int ldd) {
+  TileDots<D>(a, na, lda, b, nb, ldb, n,
+              [&](int i, int j, float d) { dot[i * ldd + j] = d; });
+}
+
+template <int D>
+float DotHalf(const uint16_t *a, const uint16_t *b, int n) {
+  const int dim = D > 0 ? D : n;
+  int k = 0;
+  float sum = 0.f;
+#if defined(__aarch64__)
+  vfloat acc = VZero();
+  for (; k + 4 <= dim; k += 4) {
+    vfloat va = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(a + k)));
+    vfloat vb = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(b + k)));
+    acc = VFma(acc, va, vb);
+  }
+  sum = VSum(acc);
+#elif defined(__F16C__) && defined(__AVX__)
+  vfloat acc = VZero();
+  for (; k + 8 <= dim; k += 8) {
+    vfloat va = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(a + k)));
+    vfloat vb = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(b + k)));
+    acc = VFma(acc, va, vb);
+  }
+  sum = VSum(acc);
+#endif
+  for (; k < dim; ++k) sum += HalfToFloat(a[k]) * HalfToFloat(b[k]);
+  return sum;
+}
+
+template <int D>
+int32_t DotInt8(const int8_t *a, const int8_t *b, int n) {
+  const int dim = D > 0 ? D : n;
+  int k = 0;
+  int32_t sum = 0;
+#if defined(__aarch64__) && defined(__ARM_FEATURE_DOTPROD)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; k + 16 <= dim; k += 16) {
+    acc = vdotq_s32(acc, vld1q_s8(a + k), vld1q_s8(b + k));
+  }
+  sum = vaddvq_s32(acc);
+#elif defined(__aarch64__)
+  // |q| <= 127, so two products always fit the int16 lanes
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; k + 16 <= dim; k += 16) {
+    int8x16_t va = vld1q_s8(a + k);
+    int8x16_t vb = vld1q_s8(b + k);
+    int16x8_t prod = vmull_s8(vget_low_s8(va), vget_low_s8(vb));
+    prod = vmlal_high_s8(prod, va, vb);
+    acc = vpadalq_s16(acc, prod);
+  }
+  sum = vaddvq_s32(acc);
+#elif defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (; k + 16 <= dim; k += 16) {
+    __m256i va =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(a + k)));
+    __m256i vb =
+        _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *)(b + k)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                            _mm256_extracti128_si256(acc, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+  sum = _mm_cvtsi128_si32(s);
+#elif defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (; k + 16 <= dim; k += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i *)(a + k));
+    __m128i vb = _mm_loadu_si128((const __m128i *)(b + k));
+    // sign extend to int16: duplicate each byte and shift the copy out
+    __m128i alo = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+    __m128i ahi = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+    __m128i blo = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+    __m128i bhi = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(alo, blo));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(ahi, bhi));
+  }
+  __m128i s = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+  sum = _mm_cvtsi128_si32(s);
+#endif
+  for (; k < dim; ++k) sum += a[k] * b[k];
+  return sum;
+}
+
+// out(i, j, dot) for every pair of FP16 rows, in blocks of b.
+template <int D, class Out>
+inline void PairDotsHalf(const uint16_t *a, int na, int lda,
+                         const uint16_t *b, int nb, int ldb, int n, Out out) {
+  const int dim = D > 0 ? D : n;
+  for (int jb = 0; jb < nb; jb += kBlockB) {
+    int jn = std::min(kBlockB, nb - jb);
+    for (int i = 0; i < na; ++i) {
+      for (int j = jb; j < jb + jn; ++j) {
+        out(i, j, DotHalf<D>(a + i * lda, b + j * ldb, dim));
+      }
+    }
+  }
+}
+
+// The same for INT8 rows, dot products scaled back to float.
+template <int D, class Out>
+inline void PairDotsInt8(const int8_t *a, const float *scale_a, int na,
+                         int lda, const int8_t *b, const float *scale_b,
+                         int nb, int ldb, int n, Out out) {
+  const int dim = D > 0 ? D : n;
+  for (int jb = 0; jb < nb; jb += kBlockB) {
+    int jn = std::min(kBlockB, nb - jb);
+    for (int i = 0; i < na; ++i) {
+      for (int j = jb; j < jb + jn; ++j) {
+        out(i, j, scale_a[i] * scale_b[j] *
+                      (float)DotInt8<D>(a + i * lda, b + j * ldb, dim));
+      }
+    }
+  }
+}
+
+template <int D>
+void DotMatrixHalf(const uint16_t *a, int na, int lda, const uint16_t *b,
+                   int nb, int ldb, int n, float *dot, int ldd) {
+  PairDotsHalf<D>(a, na, lda, b, nb, ldb, n,
+                  [&](int i, int j, float d) { dot[i * ldd + j] = d; });
+}
+
+template <int D>
+void DotMatrixInt8(const int8_t *a, const float *scale_a, int na, int lda,
+                   const int8_t *b, const float *scale_b, int nb, int ldb,
+                   int n, float *dot, int ldd) {
+  PairDotsInt8<D>(a, scale_a, na, lda, b, scale_b, nb, ldb, n,
+                  [&](int i, int j, float d) { dot[i * ldd + j] = d; });
+}
+
+template <int D>
+void Blend(float *ema, const float *feat, float alpha, int n) {
+  const int dim = D > 0 ? D : n;
+  float keep = 1.f - alpha;
+  for (int k = 0; k < dim; ++k) {
+    ema[k] = ema[k] * keep + feat[k] * alpha;
+  }
+}
+
+template <int D>
+FeatKernels MakeKernels() {
+  FeatKernels kernels;
+  kernels.dim = D;
+  kernels.dot = &Dot<D>;
+  kernels.dot_matrix = &DotMatrix<D>;
+  kernels.dot_half = &DotHalf<D>;
+  kernels.dot_matrix_half = &DotMatrixHalf<D>;
+  kernels.dot_int8 = &DotInt8<D>;
+  kernels.dot_matrix_int8 = &DotMatrixInt8<D>;
+  kernels.blend = &Blend<D>;
+  return kernels;
+}
+
+}  // namespace
+
+float FeatDot(const float *a, const float *b, int dim) {
+  return Dot<0>(a, b, dim);
+}
+
+void FeatToHalf(const float *src, int dim, uint16_t *dst) {
+  int k = 0;
+#if defined(__aarch64__)
+  for (; k + 4 <= dim; k += 4) {
+    vst1_u16(dst + k, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + k))));
+  }
+#elif defined(__F16C__)
+  for (; k + 4 <= dim; k += 4) {
+    __m128i half =
+        _mm_cvtps_ph(_mm_loadu_ps(src + k), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storel_epi64((__m128i *)(dst + k), half);
+  }
+#endif
+  for (; k < dim; ++k) dst[k] = FloatToHalf(src[k]);
+}
+
+void HalfToFeat(const uint16_t *src, int dim, float *dst) {
+  int k = 0;
+#if defined(__aarch64__)
+  for (; k + 4 <= dim; k += 4) {
+    vst1q_f32(dst + k, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + k))));
+  }
+#elif defined(__F16C__)
+  for (; k + 4 <= dim; k += 4) {
+    _mm_storeu_ps(dst + k,
+                  _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(src + k))));
+  }
+#endif
+  for (; k < dim; ++k) dst[k] = HalfToFloat(src[k]);
+}
+
+float FeatToInt8(const float *src, int dim, int8_t *dst) {
+  float max_abs = 0.f;
+  for (int k = 0; k < dim; ++k) max_abs = std::max(max_abs, std::fabs(src[k]));
+  if (max_abs == 0.f) {
+    std::fill(dst, dst + dim, 0);
+    return 0.f;
+  }
+  float scale = max_abs / 127.f;
+  float inv = 127.f / max_abs;
+  for (int k = 0; k < dim; ++k) {
+    int q = (int)std::lrint(src[k] * inv);
+    dst[k] = (int8_t)std::min(127, std::max(-127, q));
+  }
+  return scale;
+}
+
+float FeatDotHalf(const uint16_t *a, const uint16_t *b, int dim) {
+  return DotHalf<0>(a, b, dim);
+}
+
+int32_t FeatDotInt8(const int8_t *a, const int8_t *b, int dim) {
+  return DotInt8<0>(a, b, dim);
+}
+
+void FeatDotMatrix(const float *a, int na, int lda, const float *b, int nb,
+                   int ldb, int dim, float *dot, int ldd) {
+  DotMatrix<0>(a, na, lda, b, nb, ldb, dim, dot, ldd);
+}
+
+void FeatDotMatrixHalf(const uint16_t *a, int na, int lda, const uint16_t *b,
+                       int nb, int ldb, int dim, float *dot, int ldd) {
+  DotMatrixHalf<0>(a, na, lda, b, nb, ldb, dim, dot, ldd);
+}
+
+void FeatDotMatrixInt8(const int8_t *a, const float *scale_a, int na, int lda,
+                       const int8_t *b, const float *scale_b, int nb, int ldb,
+                       int dim, float *dot, int ldd) {
+  DotMatrixInt8<0>(a, scale_a, na, lda, b, scale_b, nb, ldb, dim, dot, ldd);
+}
+
+const FeatKernels &FeatKernelsFor(int dim) {
+  static const FeatKernels generic = MakeKernels<0>();
+  static const FeatKernels k128 = MakeKernels<128>();
+  static const FeatKernels k256 = MakeKernels<256>();
+  static const FeatKernels k512 = MakeKernels<512>();
+  switch (dim) {
+    case 128:
+      return k128;
+    case 256:
+      return k256;
+    case 512:
+      return k512;
+    default:
+      return generic;
+  }
+}
+
+float FeatUnitDistance(float dot) {
+  return std::sqrt(std::max(2.f - 2.f * dot, 0.f));
+}
+
+float FeatUnitDot(float distance) { return 1.f - 0.5f * distance * distance; }
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FTD_DISTANCE_HPP_
+#define _FTD_DISTANCE_HPP_
+
+#include <cstdint>
+
+namespace vitis {
+namespace ai {
+
+/// Dot product of two float vectors of length dim.
+float FeatDot(const float *a, const float *b, int dim);
+
+/// Quantized feature storage, see FTD_Gallery.
+///
+/// FP16 rows hold IEEE half bit patterns (round to nearest even). INT8 rows
+/// are symmetric per vector: x ~= q * scale with q in [-127, 127] and
+/// scale = max|x| / 127. Rows are quantized at unit norm and compared with
+/// the dot kernels below, FeatDotMatrixHalf and FeatDotMatrixInt8.
+void FeatToHalf(const float *src, int dim, uint16_t *dst);
+void HalfToFeat(const uint16_t *src, int dim, float *dst);
+/// Returns the scale of the quantized row.
+float FeatToInt8(const float *src, int dim, int8_t *dst);
+
+/// Dot product of two FP16 rows, accumulated in float.
+float FeatDotHalf(const uint16_t *a, const uint16_t *b, int dim);
+/// Integer dot product of two INT8 rows; int32 accumulation is exact for
+/// any dim below 2^17.
+int32_t FeatDotInt8(const int8_t *a, const int8_t *b, int dim);
+
+/// Dot product of every row of a (na x dim) with every row of b (nb x dim),
+/// written row-major to dot (na x nb, leading dimension ldd), with a
+/// register-blocked kernel (NEON on aarch64, SSE/AVX on x86, scalar
+/// otherwise). For unit rows this is all the distance needs: it is a
+/// monotone function of the dot product, see FeatUnitDistance.
+void FeatDotMatrix(const float *a, int na, int lda, const float *b, int nb,
+                   int ldb, int dim, float *dot, int ldd);
+void FeatDotMatrixHalf(const uint16_t *a, int na, int lda, const uint16_t *b,
+                       int nb, int ldb, int dim, float *dot, int ldd);
+void FeatDotMatrixInt8(const int8_t *a, const float *scale_a, int na, int lda,
+                       const int8_t *b, const float *scale_b, int nb, int ldb,
+                       int dim, float *dot, int ldd);
+
+/// Distance of two unit vectors from their dot product, sqrt(2 - 2 a.b)
+/// clamped at 0, and back: the dot product above which two unit vectors are
+/// closer than distance.
+float FeatUnitDistance(float dot);
+float FeatUnitDot(float distance);
+
+/// The kernels above for one feature dim. Common reid widths (128, 256,
+/// 512) get versions specialized at compile time; the dim argument of the
+/// functions is then ignored. Other widths get the generic versions.
+struct FeatKernels {
+  /// Specialized dim, 0 for the generic kernels.
+  int dim;
+  float (*dot)(const float *a, const float *b, int dim);
+  void (*dot_matrix)(const float *a, int na, int lda, const float *b, int nb,
+                     int ldb, int dim, float *dot, int ldd);
+  float (*dot_half)(const uint16_t *a, const uint16_t *b, int dim);
+  void (*dot_matrix_half)(const uint16_t *a, int na, int lda,
+                          const uint16_t *b, int nb, int ldb, int dim,
+                          float *dot, int ldd);
+  int32_t (*dot_int8)(const int8_t *a, const int8_t *b, int dim);
+  void (*dot_matrix_int8)(const int8_t *a, const float *scale_a, int na,
+                          int lda, const int8_t *b, const float *scale_b,
+                          int nb, int ldb, int dim, float *dot, int ldd);
+  /// ema = ema * (1 - alpha) + feat * alpha
+  void (*blend)(float *ema, const float *feat, float alpha, int dim);
+};
+
+/// Picks the kernels for dim; call once when the dim is known.
+const FeatKernels &FeatKernelsFor(int dim);
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FTD_EVENT_RING_HPP_
+#define _FTD_EVENT_RING_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "ftd_trajectory.hpp"
+
+namespace vitis {
+namespace ai {
+
+/// Bounded ring of track lifecycle events.
+///
+/// One producer (the thread running Update) and one consumer (any thread
+/// draining with Pop) share the ring without a lock: each side only writes
+/// its own counter. The storage is allocated once; when the consumer falls
+/// behind and the ring is full, new events are dropped and counted instead
+/// of overwriting entries the consumer may be reading.
+class FTD_EventRing {
+ public:
+  explicit FTD_EventRing(size_t capacity)
+      : buffer_(capacity), head_(0), tail_(0), dropped_(0) {}
+  FTD_EventRing(const FTD_EventRing &) = delete;
+  FTD_EventRing &operator=(const FTD_EventRing &) = delete;
+
+  size_t capacity() const { return buffer_.size(); }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  void Push(TrackEvent::Type type, uint64_t frame_id, uint64_t gid,
+            int local_id) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= buffer_.size()) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    buffer_[tail % buffer_.size()] = TrackEvent{type, frame_id, gid, local_id};
+    tail_.store(tail + 1, std::memory_order_release);
+  }
+
+  /// Moves up to max_count of the oldest events to events, returns how many.
+  size_t Pop(TrackEvent *events, size_t max_count) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    size_t count = std::min<uint64_t>(tail - head, max_count);
+    for (size_t k = 0; k < count; ++k) {
+      events[k] = buffer_[(head + k) % buffer_.size()];
+    }
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+ private:
+  std::vector<TrackEvent> buffer_;
+  // events ever pushed (tail_) and popped (head_)
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> tail_;
+  std::atomic<uint64_t> dropped_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ftd_filter_kalman.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace vitis {
+namespace ai {
+
+// standard deviations relative to the box scale, per frame
+static const float kStdPos = 1.f / 20.f;
+static const float kStdVel = 1.f / 160.f;
+static const float kStdRatio = 1e-2f;
+static const float kStdRatioMeasure = 1e-1f;
+
+bool FTD_KalmanModels::Selected(const SpecifiedCfg &specified_cfg) {
+  auto &region = std::get<0>(specified_cfg);
+  return std::all_of(region.begin(), region.end(),
+                     [](int r) { return r == 0; });
+}
+
+void FTD_KalmanModels::Resize(int rows) {
+  // grow with slack, the track count changes every frame
+  if ((int)state_.capacity() < rows) {
+    state_.reserve(2 * rows);
+    box_.reserve(2 * rows);
+    bad.reserve(2 * rows);
+  }
+  state_.resize(rows);
+  box_.resize(rows);
+  bad.resize(rows);
+}
+
+void FTD_KalmanModels::Move(int from, int to) {
+  state_[to] = state_[from];
+  box_[to] = box_[from];
+  bad[to] = bad[from];
+}
+
+void FTD_KalmanModels::Init(int row, const cv::Rect_<float> &bbox) {
+  State &s = state_[row];
+  cv::Rect_<float> z = ConvertBboxToZL(bbox);
+  float scale = std::sqrt(z.width);
+  float var[kDimX] = {2 * kStdPos * scale,  2 * kStdPos * scale,
+                      4 * kStdPos * z.width, kStdRatio * z.height,
+                      10 * kStdVel * scale, 10 * kStdVel * scale,
+                      20 * kStdVel * z.width};
+  std::memset(&s, 0, sizeof(s));
+  s.x[0] = z.x;
+  s.x[1] = z.y;
+  s.x[2] = z.width;
+  s.x[3] = z.height;
+  for (int i = 0; i < kDimX; ++i) s.P[i][i] = var[i] * var[i];
+  SetBox(row);
+}
+
+void FTD_KalmanModels::Save(FTD_SnapshotOut &out, int row) const {
+  out.Put(state_[row]);
+}
+
+bool FTD_KalmanModels::Load(FTD_SnapshotIn &in, int row) {
+  State state;
+  if (!in.Get(state)) return false;
+  // the update multiplies entries, their products must stay finite; a
+  // variance is never negative
+  const float limit = std::sqrt(std::numeric_limits<float>::max());
+  bool ok = true;
+  for (float v : state.x) ok = ok && std::fabs(v) < limit;
+  for (auto &p : state.P)
+    for (float v : p) ok = ok && std::fabs(v) < limit;
+  for (int i = 0; i < kDimX; ++i) ok = ok && state.P[i][i] >= 0.f;
+  if (!ok) {
+    in.Fail();
+    return false;
+  }
+  state_[row] = state;
+  SetBox(row);
+  return true;
+}
+
+void FTD_KalmanModels::SetBox(int row) {
+  const float *x = state_[row].x;
+  box_[row] = ConvertZToBboxL(cv::Rect_<float>(x[0], x[1], x[2], x[3]));
+  bad[row] = box_[row].width <= 0.f || box_[row].height <= 0.f;
+}
+
+void FTD_KalmanModels::Predict() {
+  int n = size();
+  for (int row = 0; row < n; ++row) {
+    State &s = state_[row];
+    float *x = s.x;
+    // the area must not shrink below zero, stop it instead
+    if (x[2] + x[6] <= 0.f) x[6] = 0.f;
+    x[0] += x[4];
+    x[1] += x[5];
+    x[2] += x[6];
+    // P = F P F' + Q; F adds velocity i + 4 to position i for i < 3
+    for (int i = 0; i < 3; ++i)
+      for (int k = 0; k < kDimX; ++k) s.P[i][k] += s.P[i + 4][k];
+    for (int k = 0; k < kDimX; ++k)
+      for (int j = 0; j < 3; ++j) s.P[k][j] += s.P[k][j + 4];
+    float area = std::max(x[2], 0.f);
+    float scale = std::sqrt(area);
+    float q[kDimX] = {kStdPos * scale,  kStdPos * scale, 2 * kStdPos * area,
+                      kStdRatio * x[3], kStdVel * scale, kStdVel * scale,
+                      2 * kStdVel * area};
+    for (int i = 0; i < kDimX; ++i) s.P[i][i] += q[i] * q[i];
+    SetBox(row);
+  }
+}
+
+void FTD_KalmanModels::Update(const int *rows, const cv::Rect_<float> *boxes,
+                              int n) {
+  for (int i = 0; i < n; ++i) {
+    UpdateRow(rows[i], boxes[i]);
+    SetBox(rows[i]);
+  }
+}
+
+void FTD_KalmanModels::UpdateRow(int row, const cv::Rect_<float> &bbox) {
+  State &s = state_[row];
+  cv::Rect_<float> z = ConvertBboxToZL(bbox);
+  float area = std::max(s.x[2], 0.f);
+  float scale = std::sqrt(area);
+  float r[kDimZ] = {kStdPos * scale, kStdPos * scale, 2 * kStdPos * area,
+                    kStdRatioMeasure * std::max(s.x[3], 0.f)};
+  float y[kDimZ] = {z.x - s.x[0], z.y - s.x[1], z.width - s.x[2],
+                    z.height - s.x[3]};
+
+  // S = H P H' + R, factored as L L'
+  float L[kDimZ][kDimZ] = {};
+  for (int i = 0; i < kDimZ; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      float sum = s.P[i][j] + (i == j ? r[i] * r[i] : 0.f);
+      for (int k = 0; k < j; ++k) sum -= L[i][k] * L[j][k];
+      if (i == j) {
+        if (!(sum > 0.f)) {
+          // lost positive definiteness, restart from the detection
+          Init(row, bbox);
+          return;
+        }
+        L[i][i] = std::sqrt(sum);
+      } else {
+        L[i][j] = sum / L[j][j];
+      }
+    }
+  }
+  // K' = S^-1 H P, solved column by column; HP are the first rows of P
+  float HP[kDimZ][kDimX];
+  float Kt[kDimZ][kDimX];
+  std::memcpy(HP, s.P, sizeof(HP));
+  for (int c = 0; c < kDimX; ++c) {
+    float t[kDimZ];
+    for (int i = 0; i < kDimZ; ++i) {
+      float sum = HP[i][c];
+      for (int k = 0; k < i; ++k) sum -= L[i][k] * t[k];
+      t[i] = sum / L[i][i];
+    }
+    for (int i = kDimZ - 1; i >= 0; --i) {
+      float sum = t[i];
+      for (int k = i + 1; k < kDimZ; ++k) sum -= L[k][i] * Kt[k][c];
+      Kt[i][c] = sum / L[i][i];
+    }
+  }
+  // x += K y, P -= K H P
+  for (int i = 0; i < kDimX; ++i) {
+    float dx = 0.f;
+    for (int j = 0; j < kDimZ; ++j) dx += Kt[j][i] * y[j];
+    s.x[i] += dx;
+  }
+  for (int i = 0; i < kDimX; ++i)
+    for (int k = 0; k < kDimX; ++k) {
+      float d = 0.f;
+      for (int j = 0; j < kDimZ; ++j) d += Kt[j][i] * HP[j][k];
+      s.P[i][k] -= d;
+    }
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FTD_FILTER_KALMAN_HPP_
+#define _FTD_FILTER_KALMAN_HPP_
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include "ftd_filter_linear.hpp"
+
+namespace vitis {
+namespace ai {
+
+/// Constant velocity Kalman filters of all live tracks, one row per track.
+///
+/// The state is the z representation of ConvertBboxToZL (center, area and
+/// aspect ratio) followed by the velocities of center and area; the aspect
+/// ratio only moves with the process noise. Noise is relative to the box
+/// scale, so normalized and pixel coordinates behave alike. Covariances are
+/// fixed 7x7 arrays: Predict advances every row in one pass and Update
+/// corrects all matched rows in one batch. Rows follow the track list of
+/// the owner, like FTD_LinearModels.
+class FTD_KalmanModels {
+ public:
+  FTD_KalmanModels(){};
+  ~FTD_KalmanModels(){};
+
+  /// The Kalman model is selected by an all_region of zeros, the linear
+  /// model has no use for empty regression windows.
+  static bool Selected(const SpecifiedCfg &specified_cfg);
+
+  int size() const { return state_.size(); }
+  void Resize(int rows);
+  void Move(int from, int to);
+  /// Starts a row at the detection box with zero velocity.
+  void Init(int row, const cv::Rect_<float> &bbox);
+  /// Advances every row by one frame; bad is set for rows whose predicted
+  /// box is empty.
+  void Predict();
+  /// Corrects row rows[i] with the detection boxes[i], for i < n.
+  void Update(const int *rows, const cv::Rect_<float> *boxes, int n);
+  /// Snapshot of the state of one row.
+  void Save(FTD_SnapshotOut &out, int row) const;
+  bool Load(FTD_SnapshotIn &in, int row);
+  /// Predicted box, or the corrected one after Update.
+  const cv::Rect_<float> &Box(int row) const { return box_[row]; }
+
+  std::vector<char> bad;
+
+ private:
+  static const int kDimX = 7;
+  static const int kDimZ = 4;
+  struct State {
+    float x[kDimX];
+    float P[kDimX][kDimX];
+  };
+  void UpdateRow(int row, const cv::Rect_<float> &bbox);
+  void SetBox(int row);
+
+  std::vector<State> state_;
+  std::vector<cv::Rect_<float>> box_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -16,6 +16,7 @@
 
 #include "ftd_filter_linear.hpp"
 #include <glog/logging.h>
+#include <cmath>
 #include <iostream>
 #include <tuple>
 using namespace std;
@@ -44,16 +45,17 @@ cv::Rect_<float> ConvertZToBboxL(const cv::Rect_<float> &z) {
   }
 }
 
-void FTD_Filter_Linear::LeastSquare(std::vector<std::array<double, 2>> &coord,
+void FTD_Filter_Linear::LeastSquare(FTD_Window &coord,
                                     std::array<double, 8> &para, double x,
                                     int region) {
   // if(!coord.empty()) std::cout<<"frameid: "<<frame_id<<" coords:
-  // "<<coord.back()[0]<<std::endl;
+  // "<<coord.Frame(coord.size() - 1)<<std::endl;
   // LOG_IF(INFO, 1) << "frame_id double: " << frame_id
   //                << " dis: " << frame_max - frame_start;
-  CHECK(coord.empty() || float(frame_id) > coord.back()[0])
+  float frame_id = Clock();
+  CHECK(coord.empty() || float(frame_id) > coord.Frame(coord.size() - 1))
       << "coord must be ascending";
-  CHECK(region >= 1) << "error region";
+  CHECK(region >= 1 && region < FTD_Window::kCapacity) << "error region";
   std::array<double, 2> tmp_coord;
   tmp_coord[0] = frame_id;
   tmp_coord[1] = x;
@@ -63,15 +65,16 @@ void FTD_Filter_Linear::LeastSquare(std::vector<std::array<double, 2>> &coord,
   para[5] += tmp_coord[1];
   para[6] += 1;
   para[7] += tmp_coord[1] * tmp_coord[1];
-  coord.push_back(tmp_coord);
-  while ((int)coord.size() > region) {
-    para[2] -= coord[0][0] * coord[0][1];
-    para[3] -= coord[0][0];
-    para[4] -= coord[0][0] * coord[0][0];
-    para[5] -= coord[0][1];
+  coord.Push(tmp_coord[0], tmp_coord[1]);
+  while (coord.size() > region) {
+    double t = coord.Frame(0), v = coord.Value(0);
+    para[2] -= t * v;
+    para[3] -= t;
+    para[4] -= t * t;
+    para[5] -= v;
     para[6] -= 1;
-    para[7] -= coord[0][1] * coord[0][1];
-    coord.erase(coord.begin());
+    para[7] -= v * v;
+    coord.Pop();
   }
   if (coord.size() == 1) {
     para[0] = 0.d;
@@ -89,17 +92,16 @@ void FTD_Filter_Linear::LeastSquare(std::vector<std::array<double, 2>> &coord,
   //                << " " << para[3] << " " << para[4] << " " << para[5] << " "
   //                << para[6] << " " << para[7];
 }
-void FTD_Filter_Linear::ClearSquare(std::vector<std::array<double, 2>> &coord,
+void FTD_Filter_Linear::ClearSquare(FTD_Window &coord,
                                     std::array<double, 8> &para, double step) {
-  for (auto &tmp_coord : coord) {
-    tmp_coord[0] -= step;
-  }
+  // the stored frames are shifted lazily, see FTD_Window
+  coord.Wrap();
   para[2] = para[2] - step * para[5];
   para[4] = para[4] - 2 * step * para[3] + step * step * para[6];
   para[3] = para[3] - step * para[6];
   if (coord.size() == 1) {
     para[0] = 0.d;
-    para[1] = coord[0][1];
+    para[1] = coord.Value(0);
   } else {
     double V = para[6] * para[4] - para[3] * para[3];
     para[0] = (para[6] * para[2] - para[3] * para[5]) / V;
@@ -107,22 +109,23 @@ void FTD_Filter_Linear::ClearSquare(std::vector<std::array<double, 2>> &coord,
   }
 }
 
-void FTD_Filter_Linear::LeastMean(std::vector<std::array<double, 2>> &coord,
+void FTD_Filter_Linear::LeastMean(FTD_Window &coord,
                                   std::array<double, 4> &para, double x,
                                   int region) {
-  CHECK(coord.empty() || float(frame_id) > coord.back()[0])
+  float frame_id = Clock();
+  CHECK(coord.empty() || float(frame_id) > coord.Frame(coord.size() - 1))
       << "coord must be ascending";
-  CHECK(region >= 1) << "error region";
+  CHECK(region >= 1 && region < FTD_Window::kCapacity) << "error region";
   std::array<double, 2> tmp_coord;
   tmp_coord[0] = frame_id;
   tmp_coord[1] = x;
   para[2] += tmp_coord[1];
   para[3] += 1;
-  coord.push_back(tmp_coord);
-  while ((int)coord.size() > region) {
-    para[2] -= coord[0][1];
+  coord.Push(tmp_coord[0], tmp_coord[1]);
+  while (coord.size() > region) {
+    para[2] -= coord.Value(0);
     para[3] -= 1;
-    coord.erase(coord.begin());
+    coord.Pop();
   }
   if (coord.size() == 1) {
     para[0] = 0.d;
@@ -132,20 +135,95 @@ void FTD_Filter_Linear::LeastMean(std::vector<std::array<double, 2>> &coord,
     para[1] = para[2] / para[3];
   }
 }
-void FTD_Filter_Linear::ClearMean(std::vector<std::array<double, 2>> &coord,
+void FTD_Filter_Linear::ClearMean(FTD_Window &coord,
                                   std::array<double, 4> &para, double step) {
-  for (auto &tmp_coord : coord) {
-    tmp_coord[0] -= step;
-  }
+  coord.Wrap();
   if (coord.size() == 1) {
     para[0] = 0.d;
-    para[1] = coord[0][1];
+    para[1] = coord.Value(0);
   } else {
     para[0] = 0.d;
     para[1] = para[2] / para[3];
   }
 }
 
+void FTD_LinearModels::Resize(int rows) {
+  // grow with slack, the track count changes every frame
+  size_t cap = (int)frame.capacity() < rows ? 2 * rows : 0;
+  for (auto v : {&ax, &bx, &ay, &by, &as, &bs, &ar, &br}) {
+    if (cap) v->reserve(cap);
+    v->resize(rows);
+  }
+  for (auto v : {&frame, &box_x, &box_y, &box_w, &box_h}) {
+    if (cap) v->reserve(cap);
+    v->resize(rows);
+  }
+  if (cap) bad.reserve(cap);
+  bad.resize(rows);
+}
+
+void FTD_LinearModels::Move(int from, int to) {
+  for (auto v : {&ax, &bx, &ay, &by, &as, &bs, &ar, &br}) (*v)[to] = (*v)[from];
+  for (auto v : {&frame, &box_x, &box_y, &box_w, &box_h})
+    (*v)[to] = (*v)[from];
+  bad[to] = bad[from];
+}
+
+void FTD_LinearModels::Step(std::vector<int> &wrapped) {
+  wrapped.clear();
+  int n = size();
+  if ((int)wrapped.capacity() < n) wrapped.reserve(frame.capacity());
+  for (int i = 0; i < n; ++i) {
+    float f = frame[i] + 0.001f;
+    if (f >= frame_max_)
+      wrapped.push_back(i);
+    else
+      frame[i] = f;
+  }
+}
+
+void FTD_LinearModels::Predict() {
+  int n = size();
+  const float *t = frame.data();
+  const double *pax = ax.data(), *pbx = bx.data(), *pay = ay.data(),
+               *pby = by.data(), *pas = as.data(), *pbs = bs.data(),
+               *par = ar.data(), *pbr = br.data();
+  float *px = box_x.data(), *py = box_y.data();
+  float *pw = box_w.data(), *ph = box_h.data();
+  // the models are evaluated as in GetPre, this pass vectorizes
+  for (int i = 0; i < n; ++i) {
+    px[i] = pax[i] * t[i] + pbx[i];
+    py[i] = pay[i] * t[i] + pby[i];
+    pw[i] = pas[i] * t[i] + pbs[i];
+    ph[i] = par[i] * t[i] + pbr[i];
+  }
+  // z to box as in ConvertZToBboxL, in place; the square root may set errno
+  // and keeps this pass scalar
+  for (int i = 0; i < n; ++i) {
+    float zs = pw[i], zr = ph[i];
+    if (zs > 0.f && zr > 0.f) {
+      pw[i] = std::sqrt(zs * zr);
+      ph[i] = zs / pw[i];
+      px[i] -= pw[i] / 2.f;
+      py[i] -= ph[i] / 2.f;
+    } else {
+      px[i] = py[i] = pw[i] = ph[i] = 0.f;
+    }
+    bad[i] = pw[i] <= 0.f || ph[i] <= 0.f;
+  }
+}
+
+void FTD_Filter_Linear::Publish() {
+  models_->ax[row_] = parax[0];
+  models_->bx[row_] = parax[1];
+  models_->ay[row_] = paray[0];
+  models_->by[row_] = paray[1];
+  models_->as[row_] = paras[0];
+  models_->bs[row_] = paras[1];
+  models_->ar[row_] = parar[0];
+  models_->br[row_] = parar[1];
+}
+
 void FTD_Filter_Linear::Init(const cv::Rect_<float> &bbox, int mode,
                              const SpecifiedCfg &specified_cfg) {
   switch (mode) {
@@ -159,18 +237,27 @@ void FTD_Filter_Linear::Init(const cv::Rect_<float> &bbox, int mode,
     default:
       break;
   }
-  frame_id = frame_start;
+  CHECK(models_ != nullptr) << "FTD_Filter_Linear must be bound before Init";
+  models_->SetClock(frame_start, frame_max);
+  Clock() = frame_start;
   // allregion = std::get<0>(specified_cfg);
   allregion = std::array<int, 4>({3, 3, 1, 1});
   parax = std::array<double, 8>{0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d};
   paray = std::array<double, 8>{0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d};
   paras = std::array<double, 8>{0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d, 0.d};
   parar = std::array<double, 4>{0.d, 0.d, 0.d, 0.d};
+  // filters are reused by pooled trajectories, drop the previous windows
+  double step = frame_max - frame_start;
+  coordx.Clear(step);
+  coordy.Clear(step);
+  coords.Clear(step);
+  coordr.Clear(step);
   cv::Rect_<float> z = ConvertBboxToZL(bbox);
   LeastSquare(coordx, parax, z.x, allregion[0]);
   LeastSquare(coordy, paray, z.y, allregion[1]);
   LeastSquare(coords, paras, z.width, allregion[2]);
   LeastMean(coordr, parar, z.height, allregion[3]);
+  Publish();
 }
 
 void FTD_Filter_Linear::UpdateDetect(const cv::Rect_<float> &bbox) {
@@ -179,6 +266,7 @@ void FTD_Filter_Linear::UpdateDetect(const cv::Rect_<float> &bbox) {
   LeastSquare(coordy, paray, z.y, allregion[1]);
   LeastSquare(coords, paras, z.width, allregion[2]);
   LeastMean(coordr, parar, z.height, allregion[3]);
+  Publish();
 }
 
 void FTD_Filter_Linear::UpdateReidTracker(const cv::Rect_<float> &bbox) {
@@ -191,27 +279,129 @@ void FTD_Filter_Linear::UpdateReidTracker(const cv::Rect_<float> &bbox) {
 
 void FTD_Filter_Linear::UpdateFilter() {}
 
+void FTD_Filter_Linear::Wrap() {
+  // frame_id -= (frame_max - frame_start);
+  Clock() = frame_start + 0.001f;
+  ClearSquare(coordx, parax, (frame_max - frame_start));
+  ClearSquare(coordy, paray, (frame_max - frame_start));
+  ClearSquare(coords, paras, (frame_max - frame_start));
+  ClearMean(coordr, parar, (frame_max - frame_start));
+  Publish();
+}
+
+void FTD_Filter_Linear::Save(FTD_SnapshotOut &out) const {
+  out.Put(frame_start);
+  out.Put(frame_max);
+  out.Put(models_->frame[row_]);
+  out.Put(allregion);
+  for (auto *coord : {&coordx, &coordy, &coords, &coordr}) out.Put(*coord);
+  out.Put(parax);
+  out.Put(paray);
+  out.Put(paras);
+  out.Put(parar);
+}
+
+// The running sums of a restored window must be the ones of its samples up
+// to rounding, and the line the one LeastSquare or LeastMean fits to them;
+// see ClearSquare for the sums of a wrapped window.
+static bool Near(double a, double b) {
+  return std::fabs(a - b) <= 1e-6 * (1.0 + std::fabs(b));
+}
+
+static bool SquareMatches(const FTD_Window &coord,
+                          const std::array<double, 8> &para) {
+  double tv = 0, t = 0, tt = 0, v = 0, vv = 0;
+  for (int i = 0; i < coord.size(); ++i) {
+    double ti = coord.Frame(i), vi = coord.Value(i);
+    tv += ti * vi;
+    t += ti;
+    tt += ti * ti;
+    v += vi;
+    vv += vi * vi;
+  }
+  if (para[6] != coord.size() || !Near(para[2], tv) || !Near(para[3], t) ||
+      !Near(para[4], tt) || !Near(para[5], v) || !Near(para[7], vv))
+    return false;
+  if (coord.size() == 1) return para[0] == 0.0 && para[1] == coord.Value(0);
+  double V = para[6] * para[4] - para[3] * para[3];
+  return para[0] == (para[6] * para[2] - para[3] * para[5]) / V &&
+         para[1] == (para[4] * para[5] - para[2] * para[3]) / V;
+}
+
+static bool MeanMatches(const FTD_Window &coord,
+                        const std::array<double, 4> &para) {
+  double v = 0;
+  for (int i = 0; i < coord.size(); ++i) v += coord.Value(i);
+  if (para[3] != coord.size() || !Near(para[2], v) || para[0] != 0.0)
+    return false;
+  if (coord.size() == 1) return para[1] == coord.Value(0);
+  return para[1] == para[2] / para[3];
+}
+
+bool FTD_Filter_Linear::Load(FTD_SnapshotIn &in) {
+  CHECK(models_ != nullptr) << "FTD_Filter_Linear must be bound before Load";
+  float clock = 0.f;
+  in.Get(frame_start);
+  in.Get(frame_max);
+  in.Get(clock);
+  in.Get(allregion);
+  if (!in.ok()) return false;
+  // the clock must advance from where it is and wrap by a positive step
+  bool ok = std::isfinite(frame_start) && std::isfinite(frame_max) &&
+            frame_start < frame_max && clock >= frame_start &&
+            clock <= frame_max && clock + 0.001f > clock;
+  for (int region : allregion)
+    ok = ok && region >= 1 && region < FTD_Window::kCapacity;
+  if (!ok) {
+    in.Fail();
+    return false;
+  }
+  FTD_Window *coords_all[] = {&coordx, &coordy, &coords, &coordr};
+  for (int c = 0; c < 4; ++c) {
+    if (!coords_all[c]->Load(in, allregion[c])) return false;
+  }
+  in.Get(parax);
+  in.Get(paray);
+  in.Get(paras);
+  in.Get(parar);
+  if (!in.ok()) return false;
+  // windows wrap by the step of the clock; LeastSquare and LeastMean take
+  // samples in ascending frames, each with a clock ahead of the last one
+  double step = frame_max - frame_start;
+  for (auto *coord : coords_all) {
+    ok = ok && coord->step() == step;
+    if (coord->empty()) continue;
+    ok = ok && coord->Frame(coord->size() - 1) <= clock;
+    for (int i = 1; i < coord->size(); ++i)
+      ok = ok && coord->Frame(i - 1) < coord->Frame(i);
+  }
+  for (auto *para : {&parax, &paray, &paras})
+    for (double v : *para) ok = ok && std::isfinite(v);
+  for (double v : parar) ok = ok && std::isfinite(v);
+  ok = ok && SquareMatches(coordx, parax) && SquareMatches(coordy, paray) &&
+       SquareMatches(coords, paras) && MeanMatches(coordr, parar);
+  if (!ok) {
+    in.Fail();
+    return false;
+  }
+  models_->SetClock(frame_start, frame_max);
+  Clock() = clock;
+  Publish();
+  return true;
+}
+
 cv::Rect_<float> FTD_Filter_Linear::GetPre() {
-  cv::Rect_<float> z;
-  frame_id += 0.001f;
   // change it when frame_id max
-  if (frame_id >= frame_max) {
-    // frame_id -= (frame_max - frame_start);
-    frame_id = frame_start + 0.001f;
-    ClearSquare(coordx, parax, (frame_max - frame_start));
-    ClearSquare(coordy, paray, (frame_max - frame_start));
-    ClearSquare(coords, paras, (frame_max - frame_start));
-    ClearMean(coordr, parar, (frame_max - frame_start));
-  }
-  z.x = parax[0] * frame_id + parax[1];
-  z.y = paray[0] * frame_id + paray[1];
-  z.width = paras[0] * frame_id + paras[1];
-  z.height = parar[0] * frame_id + parar[1];
-  return ConvertZToBboxL(z);
+  if (Clock() + 0.001f >= frame_max)
+    Wrap();
+  else
+    Clock() += 0.001f;
+  return GetPost();
 }
 
 cv::Rect_<float> FTD_Filter_Linear::GetPost() {
   cv::Rect_<float> z;
+  float frame_id = Clock();
   z.x = parax[0] * frame_id + parax[1];
   z.y = paray[0] * frame_id + paray[1];
   z.width = paras[0] * frame_id + paras[1];
@@ -18,8 +18,10 @@
 #define _FTD_FILTER_LINEAR_HPP_
 /// #define _FTD_DEBUG_
 #include <array>
+#include <cmath>
 #include <opencv2/core.hpp>
 #include <vector>
+#include "ftd_snapshot.hpp"
 
 namespace vitis {
 namespace ai {
@@ -27,36 +29,174 @@ namespace ai {
 // SpecifiedCfg: all_region, BGD
 typedef std::tuple<std::array<int, 4>, std::array<int, 3>> SpecifiedCfg;
 
+// bbox to z (center x, center y, area, aspect ratio) and back; an empty
+// rect comes back for a z without positive area and ratio
+cv::Rect_<float> ConvertBboxToZL(const cv::Rect_<float> &bbox);
+cv::Rect_<float> ConvertZToBboxL(const cv::Rect_<float> &z);
+
+/// Sliding window of (frame, value) samples with inline storage.
+///
+/// Samples live in a fixed ring, the oldest one is dropped by advancing the
+/// head. When the synthetic frame clock wraps, only the window epoch moves;
+/// stored frames are shifted back by one step per missed epoch when read, so
+/// history is never rewritten.
+class FTD_Window {
+ public:
+  static const int kCapacity = 8;
+  // a track is removed long before its clock wraps this often without a
+  // detection, older samples only come from a damaged snapshot
+  static const int kMaxEpochGap = 1024;
+
+  void Clear(double step) {
+    head_ = size_ = epoch_ = 0;
+    step_ = step;
+  }
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  double step() const { return step_; }
+  void Wrap() { ++epoch_; }
+  void Push(double frame, double value) {
+    auto &s = samples_[(head_ + size_) % kCapacity];
+    s.frame = frame;
+    s.value = value;
+    s.epoch = epoch_;
+    ++size_;
+  }
+  void Pop() {
+    head_ = (head_ + 1) % kCapacity;
+    --size_;
+  }
+  double Frame(int i) const {
+    auto &s = samples_[(head_ + i) % kCapacity];
+    double frame = s.frame;
+    for (int e = s.epoch; e < epoch_; ++e) frame -= step_;
+    return frame;
+  }
+  double Value(int i) const { return samples_[(head_ + i) % kCapacity].value; }
+  /// Reads a window saved as a raw copy. Anything Push, Frame and Value can
+  /// not use fails the image: head or size out of range, more samples than
+  /// region, samples from a later or a too old epoch, values not finite.
+  bool Load(FTD_SnapshotIn &in, int region) {
+    FTD_Window window;
+    if (!in.Get(window)) return false;
+    bool ok = window.head_ >= 0 && window.head_ < kCapacity &&
+              window.size_ >= 0 && window.size_ <= region &&
+              window.epoch_ >= 0 && std::isfinite(window.step_);
+    for (int i = 0; ok && i < window.size_; ++i) {
+      auto &s = window.samples_[(window.head_ + i) % kCapacity];
+      ok = s.epoch <= window.epoch_ &&
+           window.epoch_ - s.epoch <= kMaxEpochGap && std::isfinite(s.frame) &&
+           std::isfinite(s.value);
+    }
+    if (!ok) {
+      in.Fail();
+      return false;
+    }
+    *this = window;
+    return true;
+  }
+
+ private:
+  struct Sample {
+    double frame;
+    double value;
+    int epoch;
+  };
+  std::array<Sample, kCapacity> samples_;
+  int head_ = 0;
+  int size_ = 0;
+  int epoch_ = 0;
+  double step_ = 0.0;
+};
+
+/// Prediction state of the linear filters of all live tracks, one row per
+/// track in struct-of-arrays form.
+///
+/// frame is the synthetic clock of each filter and a/b are slope and
+/// intercept of the x, y, area and aspect ratio models. The filters keep
+/// their regression sums themselves and publish the fitted lines here, so
+/// one pass over the arrays predicts every box. Rows follow the track list
+/// of the owner, which moves rows when it reorders tracks.
+class FTD_LinearModels {
+ public:
+  FTD_LinearModels(){};
+  ~FTD_LinearModels(){};
+
+  int size() const { return frame.size(); }
+  void Resize(int rows);
+  /// Copies row from into row to, predictions included.
+  void Move(int from, int to);
+  void SetClock(float start, float max) {
+    frame_start_ = start;
+    frame_max_ = max;
+  }
+  /// Advances every clock by one frame. Rows whose clock reached the end of
+  /// the range are appended to wrapped and left unchanged, their filter has
+  /// to rebase them (FTD_Filter_Linear::Wrap) before Predict.
+  void Step(std::vector<int> &wrapped);
+  /// Evaluates every model at its clock into the box arrays; bad is set for
+  /// rows whose box is empty.
+  void Predict();
+  cv::Rect_<float> Box(int row) const {
+    return cv::Rect_<float>(box_x[row], box_y[row], box_w[row], box_h[row]);
+  }
+
+  std::vector<float> frame;
+  std::vector<double> ax, bx, ay, by, as, bs, ar, br;
+  std::vector<float> box_x, box_y, box_w, box_h;
+  std::vector<char> bad;
+
+ private:
+  float frame_start_ = 0.f;
+  float frame_max_ = 0.f;
+};
+
 class FTD_Filter_Linear {
  public:
   FTD_Filter_Linear(){};
   ~FTD_Filter_Linear(){};
+  /// Places the prediction state in a row of models; must be called
+  /// before Init and again whenever the row moves.
+  void Bind(FTD_LinearModels *models, int row) {
+    models_ = models;
+    row_ = row;
+  }
   void Init(const cv::Rect_<float> &bbox, int mode,
             const SpecifiedCfg &specifed_cfg);
+  /// Rebases the regression on a clock wrap reported by
+  /// FTD_LinearModels::Step.
+  void Wrap();
   void UpdateDetect(const cv::Rect_<float> &bbox);
   void UpdateReidTracker(const cv::Rect_<float> &bbox);
   void UpdateFilter();
+  /// Snapshot of the windows, fitted lines and clock; Load needs the row
+  /// bound and publishes it.
+  void Save(FTD_SnapshotOut &out) const;
+  bool Load(FTD_SnapshotIn &in);
   cv::Rect_<float> GetPre();
   cv::Rect_<float> GetPost();
 
  private:
-  void LeastSquare(std::vector<std::array<double, 2>> &coord,
-                   std::array<double, 8> &para, double x, int region);
-  void ClearSquare(std::vector<std::array<double, 2>> &coord,
-                   std::array<double, 8> &para, double step);
-  void LeastMean(std::vector<std::array<double, 2>> &coord,
-                 std::array<double, 4> &para, double x, int region);
-  void ClearMean(std::vector<std::array<double, 2>> &coord,
-                 std::array<double, 4> &para, double step);
-  std::vector<std::array<double, 2>> coordx;
-  std::vector<std::array<double, 2>> coordy;
-  std::vector<std::array<double, 2>> coords;
-  std::vector<std::array<double, 2>> coordr;
+  void LeastSquare(FTD_Window &coord, std::array<double, 8> &para, double x,
+                   int region);
+  void ClearSquare(FTD_Window &coord, std::array<double, 8> &para,
+                   double step);
+  void LeastMean(FTD_Window &coord, std::array<double, 4> &para, double x,
+                 int region);
+  void ClearMean(FTD_Window &coord, std::array<double, 4> &para, double step);
+  float &Clock() { return models_->frame[row_]; }
+  // copies the fitted lines to the bound row
+  void Publish();
+  FTD_Window coordx;
+  FTD_Window coordy;
+  FTD_Window coords;
+  FTD_Window coordr;
   std::array<double, 8> parax;
   std::array<double, 8> paray;
   std::array<double, 8> paras;
   std::array<double, 4> parar;
-  float frame_id;
+  FTD_LinearModels *models_ = nullptr;
+  int row_ = -1;
   float frame_start;
   float frame_max;
   std::array<int, 4> allregion;
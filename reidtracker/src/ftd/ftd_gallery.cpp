@@ -0,0 +1,433 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_gallery.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vitis {
+namespace ai {
+
+// 64-byte rows and base address: one cache line, any SIMD width we use.
+static const int kAlignBytes = 64;
+static const int kMinCapacity = 16;
+// Largest feature dim a snapshot may carry, beyond it the image is damaged.
+static const int kMaxSnapshotDim = 1 << 16;
+
+static char *AlignedAlloc(size_t bytes) {
+  char *p = (char *)std::aligned_alloc(kAlignBytes, bytes);
+  CHECK(p) << "fail to allocate " << bytes << " bytes of features";
+  std::memset(p, 0, bytes);
+  return p;
+}
+
+FTD_Gallery::FTD_Gallery()
+    : bits_(32),
+      elem_size_(sizeof(float)),
+      k_(1),
+      novelty_dot_(1.f),
+      max_bytes_(0),
+      dim_(0),
+      stride_(0),
+      rows_(0),
+      capacity_(0),
+      stamp_(0),
+      query_count_(0),
+      query_capacity_(0),
+      kernels_(&FeatKernelsFor(0)) {}
+
+void FTD_Gallery::SetBits(int bits) {
+  CHECK(bits == 32 || bits == 16 || bits == 8)
+      << "feature storage must be 32, 16 or 8 bits, not " << bits;
+  CHECK(dim_ == 0) << "feature storage can not change once features are stored";
+  bits_ = bits;
+  elem_size_ = bits / 8;
+}
+
+void FTD_Gallery::SetExemplars(int k, float novelty, int max_bytes) {
+  CHECK(k >= 1) << "a track needs at least one exemplar, not " << k;
+  CHECK(dim_ == 0) << "exemplars can not change once features are stored";
+  k_ = k;
+  novelty_dot_ = FeatUnitDot(novelty);
+  max_bytes_ = max_bytes;
+}
+
+int FTD_Gallery::Alloc() {
+  int slot;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    slot = rows_++;
+    if (dim_ > 0 && rows_ > capacity_) {
+      Reserve(std::max(capacity_ * 2, kMinCapacity));
+    }
+  }
+  return slot;
+}
+
+void FTD_Gallery::Free(int slot) {
+  CHECK(slot >= 0 && slot < rows_) << "error gallery slot " << slot;
+  if (slot == rows_ - 1) {
+    rows_--;
+  } else {
+    free_slots_.push_back(slot);
+  }
+}
+
+void FTD_Gallery::Clear() {
+  rows_ = 0;
+  free_slots_.clear();
+}
+
+void FTD_Gallery::Reserve(int capacity) {
+  if (capacity <= capacity_) return;
+  size_t row_bytes = (size_t)stride_ * elem_size_;
+  Buffer anchor(AlignedAlloc(capacity * k_ * row_bytes));
+  Buffer ema(AlignedAlloc(capacity * row_bytes));
+  if (capacity_ > 0) {
+    std::memcpy(anchor.get(), anchor_.get(), capacity_ * k_ * row_bytes);
+    std::memcpy(ema.get(), ema_.get(), capacity_ * row_bytes);
+  }
+  anchor_ = std::move(anchor);
+  ema_ = std::move(ema);
+  // Free never has to grow the free list
+  free_slots_.reserve(capacity);
+  anchor_scale_.resize(capacity * k_, 0.f);
+  ema_scale_.resize(capacity, 0.f);
+  count_.resize(capacity, 0);
+  cursor_.resize(capacity, 0);
+  version_.resize(capacity, 0);
+  capacity_ = capacity;
+}
+
+void FTD_Gallery::Store(char *row, float *scale, const float *feat) {
+  // unit norm on the way in, so every distance is one dot product; a zero
+  // feature stays zero
+  float norm = kernels_->dot(feat, feat, dim_);
+  float inv = norm > 0.f ? 1.f / std::sqrt(norm) : 0.f;
+  if (bits_ == 32) {
+    float *dst = (float *)row;
+    for (int k = 0; k < dim_; ++k) dst[k] = feat[k] * inv;
+    return;
+  }
+  for (int k = 0; k < dim_; ++k) unit_[k] = feat[k] * inv;
+  if (bits_ == 16) {
+    FeatToHalf(unit_.data(), dim_, (uint16_t *)row);
+    return;
+  }
+  // the scale is chosen so the dequantized row has unit norm, not only
+  // the float it came from
+  int8_t *dst = (int8_t *)row;
+  FeatToInt8(unit_.data(), dim_, dst);
+  int32_t sum = kernels_->dot_int8(dst, dst, dim_);
+  *scale = sum > 0 ? 1.f / std::sqrt((float)sum) : 0.f;
+}
+
+void FTD_Gallery::Load(const char *row, float scale, float *feat) const {
+  switch (bits_) {
+    case 16:
+      HalfToFeat((const uint16_t *)row, dim_, feat);
+      break;
+    case 8: {
+      const int8_t *src = (const int8_t *)row;
+      for (int k = 0; k < dim_; ++k) feat[k] = src[k] * scale;
+    }; break;
+    default: {
+      const float *src = (const float *)row;
+      std::copy(src, src + dim_, feat);
+    }
+  }
+}
+
+void FTD_Gallery::SetDim(int dim) {
+  dim_ = dim;
+  int per_line = kAlignBytes / elem_size_;
+  stride_ = (dim + per_line - 1) / per_line * per_line;
+  int row_bytes = stride_ * elem_size_;
+  if (max_bytes_ > 0) {
+    // the EMA row counts against the bound too
+    k_ = std::max(1, std::min(k_, max_bytes_ / row_bytes - 1));
+  }
+  // the dim is fixed from now on, pick the kernels specialized for it
+  kernels_ = &FeatKernelsFor(dim);
+  row_.resize(dim);
+  unit_.resize(dim);
+  probe_.reset(AlignedAlloc(row_bytes));
+  Reserve(std::max(rows_, kMinCapacity));
+}
+
+void FTD_Gallery::Init(int slot, const float *feat, int dim) {
+  if (dim_ == 0) SetDim(dim);
+  CHECK(dim == dim_) << "feature dim changed: " << dim << " vs. " << dim_;
+  CHECK(slot >= 0 && slot < rows_) << "error gallery slot " << slot;
+  int row = slot * k_;
+  Store(Row(anchor_, row), &anchor_scale_[row], feat);
+  Store(Row(ema_, slot), &ema_scale_[slot], feat);
+  count_[slot] = 1;
+  cursor_[slot] = 1;
+  version_[slot] = ++stamp_;
+}
+
+void FTD_Gallery::AddExemplar(int slot, const float *feat) {
+  if (k_ == 1) return;
+  float scale = 0.f;
+  Store(probe_.get(), &scale, feat);
+  int base = slot * k_;
+  for (int e = 0; e < count_[slot]; ++e) {
+    int row = base + e;
+    float dot = Dot(Row(anchor_, row), anchor_scale_[row], probe_.get(), scale);
+    if (dot >= novelty_dot_) return;
+  }
+  // the anchor stays, exemplars 1 .. k_ - 1 are a ring
+  int e;
+  if (count_[slot] < k_) {
+    e = count_[slot]++;
+  } else {
+    e = cursor_[slot];
+    cursor_[slot] = e + 1 < k_ ? e + 1 : 1;
+  }
+  int row = base + e;
+  std::memcpy(Row(anchor_, row), probe_.get(), (size_t)stride_ * elem_size_);
+  anchor_scale_[row] = scale;
+  version_[slot] = ++stamp_;
+}
+
+void FTD_Gallery::Blend(int slot, const float *feat, float alpha) {
+  // both sides at unit norm, and the result brought back to it
+  float norm = kernels_->dot(feat, feat, dim_);
+  float inv = norm > 0.f ? 1.f / std::sqrt(norm) : 0.f;
+  for (int k = 0; k < dim_; ++k) row_[k] = feat[k] * inv;
+  if (bits_ == 32) {
+    float *ema = (float *)Row(ema_, slot);
+    kernels_->blend(ema, row_.data(), alpha, dim_);
+    Store((char *)ema, &ema_scale_[slot], ema);
+    return;
+  }
+  // quantized rows are blended in float and stored again
+  Load(Row(ema_, slot), ema_scale_[slot], unit_.data());
+  kernels_->blend(unit_.data(), row_.data(), alpha, dim_);
+  Store(Row(ema_, slot), &ema_scale_[slot], unit_.data());
+}
+
+void FTD_Gallery::ResizeQueries(int count) {
+  CHECK(dim_ > 0) << "queries need the feature dim, init a slot first";
+  if (count > query_capacity_) {
+    int capacity = std::max(count, query_capacity_ * 2);
+    query_.reset(AlignedAlloc((size_t)capacity * stride_ * elem_size_));
+    query_scale_.resize(capacity);
+    query_capacity_ = capacity;
+  }
+  query_count_ = count;
+}
+
+void FTD_Gallery::SetQuery(int query, const float *feat) {
+  CHECK(query >= 0 && query < query_count_) << "error query " << query;
+  Store(Row(query_, query), &query_scale_[query], feat);
+}
+
+void FTD_Gallery::QueryDotMatrix(float *dot, int ldd) {
+  QueryDotMatrix(dot, ldd, 0, rows_);
+}
+
+void FTD_Gallery::QueryDotMatrix(float *dot, int ldd, int begin, int end) {
+  if (end <= begin) return;
+  int nrow = (end - begin) * k_;
+  float *out = dot + (size_t)begin * ldd;
+  int ld = ldd;
+  // (end - begin) * k_ x queries, reduced to the per slot maximum; per
+  // thread, so that ranges can be computed concurrently
+  static thread_local std::vector<float> exemplar_dot;
+  if (k_ > 1) {
+    exemplar_dot.resize((size_t)nrow * query_count_);
+    out = exemplar_dot.data();
+    ld = query_count_;
+  }
+  const char *anchor = Row(anchor_, begin * k_);
+  switch (bits_) {
+    case 16:
+      kernels_->dot_matrix_half((const uint16_t *)anchor, nrow, stride_,
+                                (const uint16_t *)query_.get(), query_count_,
+                                stride_, dim_, out, ld);
+      break;
+    case 8:
+      kernels_->dot_matrix_int8((const int8_t *)anchor,
+                                anchor_scale_.data() + begin * k_, nrow,
+                                stride_, (const int8_t *)query_.get(),
+                                query_scale_.data(), query_count_, stride_,
+                                dim_, out, ld);
+      break;
+    default:
+      kernels_->dot_matrix((const float *)anchor, nrow, stride_,
+                           (const float *)query_.get(), query_count_, stride_,
+                           dim_, out, ld);
+  }
+  if (k_ == 1) return;
+  // the nearest exemplar has the largest dot product; rows of unused
+  // exemplars were computed with the rest of the block and are skipped here
+  for (int s = begin; s < end; ++s) {
+    const float *first = out + (size_t)(s - begin) * k_ * ld;
+    float *dst = dot + (size_t)s * ldd;
+    std::copy(first, first + query_count_, dst);
+    for (int e = 1; e < count_[s]; ++e) {
+      const float *row = first + (size_t)e * ld;
+      for (int j = 0; j < query_count_; ++j) dst[j] = std::max(dst[j], row[j]);
+    }
+  }
+}
+
+void FTD_Gallery::SaveFormat(FTD_SnapshotOut &out) const {
+  out.Put(bits_);
+  out.Put(k_);
+  out.Put(dim_);
+}
+
+bool FTD_Gallery::LoadFormat(FTD_SnapshotIn &in) {
+  int bits = 0, k = 0, dim = 0;
+  if (!in.Get(bits) || !in.Get(k) || !in.Get(dim)) return false;
+  if (bits != bits_ || dim < 0 || dim > kMaxSnapshotDim) {
+    in.Fail();
+    return false;
+  }
+  // a gallery that never saw a feature keeps its dim open
+  if (dim > 0 && dim_ == 0) SetDim(dim);
+  if ((dim > 0 && dim != dim_) || k != k_) {
+    LOG(WARNING) << "snapshot features (dim " << dim << ", " << k
+                 << " exemplars) do not fit the gallery (dim " << dim_
+                 << ", " << k_ << " exemplars)";
+    in.Fail();
+    return false;
+  }
+  return true;
+}
+
+void FTD_Gallery::SaveSlot(FTD_SnapshotOut &out, int slot) const {
+  // rows without their padding, which is always zero
+  size_t bytes = (size_t)dim_ * elem_size_;
+  out.Put(count_[slot]);
+  out.Put(cursor_[slot]);
+  for (int e = 0; e < count_[slot]; ++e) {
+    int row = slot * k_ + e;
+    out.Put(Row(anchor_, row), bytes);
+    out.Put(anchor_scale_[row]);
+  }
+  out.Put(Row(ema_, slot), bytes);
+  out.Put(ema_scale_[slot]);
+}
+
+bool FTD_Gallery::LoadSlot(FTD_SnapshotIn &in, int slot) {
+  CHECK(slot >= 0 && slot < rows_) << "error gallery slot " << slot;
+  int count = 0, cursor = 0;
+  if (!in.Get(count) || !in.Get(cursor)) return false;
+  if (dim_ == 0 || count < 1 || count > k_ || cursor < 0 || cursor > k_) {
+    in.Fail();
+    return false;
+  }
+  size_t bytes = (size_t)dim_ * elem_size_;
+  for (int e = 0; e < count; ++e) {
+    int row = slot * k_ + e;
+    in.Get(Row(anchor_, row), bytes);
+    in.Get(anchor_scale_[row]);
+  }
+  in.Get(Row(ema_, slot), bytes);
+  in.Get(ema_scale_[slot]);
+  if (!in.ok()) return false;
+  // rows are stored at unit norm (zero for a zero feature); anything else
+  // would put distances out of range or make them not finite
+  bool ok = UnitRow(Row(ema_, slot), ema_scale_[slot]);
+  for (int e = 0; e < count && ok; ++e) {
+    int row = slot * k_ + e;
+    ok = UnitRow(Row(anchor_, row), anchor_scale_[row]);
+  }
+  if (!ok) {
+    in.Fail();
+    return false;
+  }
+  count_[slot] = count;
+  cursor_[slot] = cursor;
+  version_[slot] = ++stamp_;
+  return true;
+}
+
+bool FTD_Gallery::UnitRow(const char *row, float scale) {
+  Load(row, scale, row_.data());
+  double norm = 0.0;
+  for (int k = 0; k < dim_; ++k) norm += (double)row_[k] * row_[k];
+  return norm == 0.0 || (norm > 0.9 && norm < 1.1);
+}
+
+int FTD_Gallery::Sync(const FTD_Gallery &from) {
+  if (from.dim_ == 0) return 0;
+  if (dim_ != from.dim_) {
+    CHECK(dim_ == 0) << "a gallery view can not change its format";
+    bits_ = from.bits_;
+    elem_size_ = from.elem_size_;
+    k_ = from.k_;
+    SetDim(from.dim_);
+  }
+  rows_ = from.rows_;
+  Reserve(from.capacity_);
+  // stamps are unique per source, an equal one is an equal slot
+  stamp_ = from.stamp_;
+  size_t bytes = (size_t)k_ * stride_ * elem_size_;
+  int copied = 0;
+  for (int slot = 0; slot < rows_; ++slot) {
+    if (version_[slot] == from.version_[slot]) continue;
+    int row = slot * k_;
+    std::memcpy(Row(anchor_, row), from.Row(from.anchor_, row), bytes);
+    std::copy(&from.anchor_scale_[row], &from.anchor_scale_[row] + k_,
+              &anchor_scale_[row]);
+    count_[slot] = from.count_[slot];
+    version_[slot] = from.version_[slot];
+    copied++;
+  }
+  return copied;
+}
+
+float FTD_Gallery::Dot(const char *a, float scale_a, const char *b,
+                       float scale_b) const {
+  switch (bits_) {
+    case 16:
+      return kernels_->dot_half((const uint16_t *)a, (const uint16_t *)b,
+                                dim_);
+    case 8:
+      return scale_a * scale_b * (float)kernels_->dot_int8((const int8_t *)a,
+                                                           (const int8_t *)b,
+                                                           dim_);
+    default:
+      return kernels_->dot((const float *)a, (const float *)b, dim_);
+  }
+}
+
+float FTD_Gallery::ExemplarDistance(int row, int query) {
+  float dot = Dot(Row(anchor_, row), anchor_scale_[row], Row(query_, query),
+                  query_scale_[query]);
+  return FeatUnitDistance(dot);
+}
+
+float FTD_Gallery::QueryDistance(int slot, int query) {
+  int base = slot * k_;
+  float dist = ExemplarDistance(base, query);
+  for (int e = 1; e < count_[slot]; ++e) {
+    dist = std::min(dist, ExemplarDistance(base + e, query));
+  }
+  return dist;
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FTD_GALLERY_HPP_
+#define _FTD_GALLERY_HPP_
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include "ftd_distance.hpp"
+#include "ftd_snapshot.hpp"
+
+namespace vitis {
+namespace ai {
+
+/// Embeddings of all trajectories, K exemplar rows and one EMA row per track
+/// slot.
+///
+/// The exemplars (used for matching) and the running EMA of each track live
+/// in two separate row-major matrices, so the distance stage streams the
+/// exemplar matrix linearly. Exemplar 0 is the anchor, the first feature
+/// seen, and is never replaced. The other K - 1 form a ring: a matched
+/// feature farther than the novelty distance from every exemplar of its
+/// track overwrites the oldest one. The distance of a track to a query is the
+/// minimum over its exemplars; with K = 1 (default) only the anchor is used.
+/// Rows are padded to 64 bytes and the storage is 64-byte aligned. Slots are
+/// recycled through a free list, so the number of rows stays at the peak
+/// number of live tracks.
+///
+/// Rows are stored as float, FP16 or INT8 with a per row scale (see
+/// SetBits), which cuts the gallery memory by 2x or 4x. The detections of a
+/// frame are registered as queries and converted to the same type, so the
+/// distances are computed by the FP16 or integer kernels directly.
+///
+/// Every row, queries included, is scaled to unit norm when it is stored
+/// (the EMA after every blend), so no norm is kept and the distance stage
+/// is a plain dot product matrix; distance thresholds map to dot products
+/// through FeatUnitDot.
+class FTD_Gallery {
+ public:
+  FTD_Gallery();
+  ~FTD_Gallery(){};
+  FTD_Gallery(const FTD_Gallery &) = delete;
+  FTD_Gallery &operator=(const FTD_Gallery &) = delete;
+  FTD_Gallery &operator=(FTD_Gallery &&) = default;
+
+  /// Storage type: 32 (float, default), 16 (FP16) or 8 (INT8). Must be set
+  /// before the first Init.
+  void SetBits(int bits);
+  int bits() const { return bits_; }
+  /// Exemplars per track (at least 1) and the novelty distance a feature
+  /// needs to become one. max_bytes > 0 bounds the feature memory of a track
+  /// (exemplars and EMA), lowering K if needed. Must be set before the first
+  /// Init.
+  void SetExemplars(int k, float novelty, int max_bytes);
+  /// Exemplars per track in effect, known after the first Init.
+  int exemplars() const { return k_; }
+
+  int Alloc();
+  void Free(int slot);
+  void Clear();
+
+  /// Set the anchor and EMA of a slot to feat, the dim is fixed on first use.
+  void Init(int slot, const float *feat, int dim);
+  /// ema = ema * (1 - alpha) + feat * alpha, in place.
+  void Blend(int slot, const float *feat, float alpha);
+  /// Keeps feat as an exemplar of slot if it is novel enough.
+  void AddExemplar(int slot, const float *feat);
+  int ExemplarCount(int slot) const { return count_[slot]; }
+
+  /// Queries are the features compared against the gallery, one per
+  /// detection: size the set, then set every query.
+  void ResizeQueries(int count);
+  void SetQuery(int query, const float *feat);
+  /// Dot product of every row (free slots included) with every query,
+  /// written to dot (rows() x queries, leading dimension ldd); the distance
+  /// is FeatUnitDistance of it.
+  void QueryDotMatrix(float *dot, int ldd);
+  /// Same for the rows of slots [begin, end) only, still written at their
+  /// own row of dot. Calls on disjoint ranges may run concurrently.
+  void QueryDotMatrix(float *dot, int ldd, int begin, int end);
+  /// Distance between one slot and one query.
+  float QueryDistance(int slot, int query);
+  /// Distance between one exemplar row (slot * exemplars() + e) and one
+  /// query.
+  float ExemplarDistance(int row, int query);
+
+  /// Snapshot of the storage format, and of the features of one slot. A
+  /// format is only loaded into a gallery of the same bits and exemplars,
+  /// before its first Init or with the same dim.
+  void SaveFormat(FTD_SnapshotOut &out) const;
+  bool LoadFormat(FTD_SnapshotIn &in);
+  void SaveSlot(FTD_SnapshotOut &out, int slot) const;
+  bool LoadSlot(FTD_SnapshotIn &in, int slot);
+
+  /// Stamp of the last change of the exemplars of slot; stamps only grow,
+  /// so equal stamps mean equal rows, also across a Sync.
+  uint64_t Version(int slot) const { return version_[slot]; }
+  /// Makes this gallery a view for matching of from: the format, the
+  /// exemplar rows and their counts and stamps, copying only the slots whose
+  /// stamp differs. The EMA is not copied. Returns the slots copied.
+  int Sync(const FTD_Gallery &from);
+
+  int dim() const { return dim_; }
+  /// Row length in elements of the storage type.
+  int stride() const { return stride_; }
+  /// Number of rows in use, including free slots below the high-water mark.
+  int rows() const { return rows_; }
+
+ private:
+  struct FreeDeleter {
+    void operator()(void *p) const { std::free(p); }
+  };
+  typedef std::unique_ptr<char[], FreeDeleter> Buffer;
+  void Reserve(int capacity);
+  // fixes the dim on the first feature (or format loaded)
+  void SetDim(int dim);
+  char *Row(const Buffer &buf, int row) const {
+    return buf.get() + (size_t)row * stride_ * elem_size_;
+  }
+  float Dot(const char *a, float scale_a, const char *b, float scale_b) const;
+  // stores feat scaled to unit norm in row, feat may be the row itself
+  void Store(char *row, float *scale, const float *feat);
+  void Load(const char *row, float scale, float *feat) const;
+  // whether a loaded row has unit norm, or is zero
+  bool UnitRow(const char *row, float scale);
+
+  int bits_;
+  int elem_size_;
+  int k_;
+  // the novelty distance as a dot product
+  float novelty_dot_;
+  int max_bytes_;
+  int dim_;
+  int stride_;
+  int rows_;
+  int capacity_;
+  // capacity_ * k_ rows
+  Buffer anchor_;
+  Buffer ema_;
+  // INT8 only
+  std::vector<float> anchor_scale_;
+  std::vector<float> ema_scale_;
+  // exemplars in use and next ring position, per slot
+  std::vector<int> count_;
+  std::vector<int> cursor_;
+  std::vector<int> free_slots_;
+  // per slot stamp of the exemplars, from stamp_
+  std::vector<uint64_t> version_;
+  uint64_t stamp_;
+
+  int query_count_;
+  int query_capacity_;
+  Buffer query_;
+  std::vector<float> query_scale_;
+  // one dequantized row and one unit feature, for Blend and Store
+  std::vector<float> row_;
+  std::vector<float> unit_;
+  // a candidate exemplar in storage format
+  Buffer probe_;
+  // chosen on the first feature, specialized for its dim when possible
+  const FeatKernels *kernels_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
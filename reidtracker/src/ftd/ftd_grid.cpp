@@ -0,0 +1,136 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_grid.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace vitis {
+namespace ai {
+
+// Upper bound on cells per axis, keeps the grid small for tiny boxes.
+static const int kMaxCells = 64;
+
+void FTD_Grid::Build(const std::vector<cv::Rect_<float>> &boxes) {
+  int n = boxes.size();
+  cols_ = rows_ = 0;
+  if (n == 0) return;
+  float x_max, y_max;
+  float sum_w = 0.f, sum_h = 0.f;
+  x_min_ = boxes[0].x;
+  y_min_ = boxes[0].y;
+  x_max = boxes[0].x + boxes[0].width;
+  y_max = boxes[0].y + boxes[0].height;
+  for (auto &b : boxes) {
+    x_min_ = std::min(x_min_, b.x);
+    y_min_ = std::min(y_min_, b.y);
+    x_max = std::max(x_max, b.x + b.width);
+    y_max = std::max(y_max, b.y + b.height);
+    sum_w += b.width;
+    sum_h += b.height;
+  }
+  float range_w = std::max(x_max - x_min_, 1e-6f);
+  float range_h = std::max(y_max - y_min_, 1e-6f);
+  float cell_w = std::max(sum_w / n, range_w / kMaxCells);
+  float cell_h = std::max(sum_h / n, range_h / kMaxCells);
+  cols_ = std::min(kMaxCells, std::max(1, (int)std::ceil(range_w / cell_w)));
+  rows_ = std::min(kMaxCells, std::max(1, (int)std::ceil(range_h / cell_h)));
+  inv_cell_w_ = cols_ / range_w;
+  inv_cell_h_ = rows_ / range_h;
+
+  // counting sort of (cell, box) entries into cell_items_
+  // the cell arrays are sized for the largest grid once, the layout changes
+  // every frame and must not reallocate
+  int ncell = cols_ * rows_;
+  if (cell_start_.capacity() < kMaxCells * kMaxCells + 1) {
+    cell_start_.reserve(kMaxCells * kMaxCells + 1);
+    cell_fill_.reserve(kMaxCells * kMaxCells + 1);
+  }
+  cell_start_.assign(ncell + 1, 0);
+  for (auto &b : boxes) {
+    int x0, y0, x1, y1;
+    CellRange(b, x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x) cell_start_[y * cols_ + x + 1]++;
+  }
+  for (int c = 0; c < ncell; ++c) cell_start_[c + 1] += cell_start_[c];
+  if ((int)cell_items_.capacity() < cell_start_[ncell])
+    cell_items_.reserve(2 * cell_start_[ncell]);
+  cell_items_.resize(cell_start_[ncell]);
+  cell_fill_.assign(cell_start_.begin(), cell_start_.end() - 1);
+  for (int i = 0; i < n; ++i) {
+    int x0, y0, x1, y1;
+    CellRange(boxes[i], x0, y0, x1, y1);
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x) cell_items_[cell_fill_[y * cols_ + x]++] = i;
+  }
+  if ((int)seen_.size() < n) seen_.resize(n, stamp_);
+}
+
+void FTD_Grid::CellRange(const cv::Rect_<float> &rect, int &x0, int &y0,
+                         int &x1, int &y1) const {
+  // clamping keeps boxes outside the covered range in the border cells
+  auto cell = [](float v, float inv, int count) {
+    int c = (int)std::floor(v * inv);
+    return std::min(std::max(c, 0), count - 1);
+  };
+  x0 = cell(rect.x - x_min_, inv_cell_w_, cols_);
+  x1 = cell(rect.x + rect.width - x_min_, inv_cell_w_, cols_);
+  y0 = cell(rect.y - y_min_, inv_cell_h_, rows_);
+  y1 = cell(rect.y + rect.height - y_min_, inv_cell_h_, rows_);
+}
+
+void FTD_Grid::Query(const cv::Rect_<float> &rect, std::vector<int> &out) {
+  if (cols_ == 0) return;
+  if (++stamp_ == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0u);
+    stamp_ = 1;
+  }
+  int x0, y0, x1, y1;
+  CellRange(rect, x0, y0, x1, y1);
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      int c = y * cols_ + x;
+      for (int k = cell_start_[c]; k < cell_start_[c + 1]; ++k) {
+        int i = cell_items_[k];
+        if (seen_[i] != stamp_) {
+          seen_[i] = stamp_;
+          out.push_back(i);
+        }
+      }
+    }
+  }
+}
+
+void FTD_Grid::QueryShared(const cv::Rect_<float> &rect,
+                          std::vector<int> &out) const {
+  if (cols_ == 0) return;
+  size_t first = out.size();
+  int x0, y0, x1, y1;
+  CellRange(rect, x0, y0, x1, y1);
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      int c = y * cols_ + x;
+      out.insert(out.end(), cell_items_.begin() + cell_start_[c],
+                 cell_items_.begin() + cell_start_[c + 1]);
+    }
+  }
+  std::sort(out.begin() + first, out.end());
+  out.erase(std::unique(out.begin() + first, out.end()), out.end());
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FTD_GRID_HPP_
+#define _FTD_GRID_HPP_
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+
+/// Uniform grid over a set of boxes, rebuilt every frame.
+///
+/// The grid covers the bounding range of the inserted boxes with cells about
+/// the size of an average box, and every box is registered in each cell it
+/// touches. Query returns every inserted box whose area may intersect the
+/// query rect (a superset of the boxes with positive overlap), each once.
+/// Works for normalized and pixel coordinates alike. Storage is kept across
+/// frames.
+class FTD_Grid {
+ public:
+  FTD_Grid(){};
+  ~FTD_Grid(){};
+
+  void Build(const std::vector<cv::Rect_<float>> &boxes);
+  /// Appends the indices of candidate boxes to out.
+  void Query(const cv::Rect_<float> &rect, std::vector<int> &out);
+  /// Same without the query stamps, so any number of threads may query at
+  /// once; slower, the candidates of rect are sorted to report each once.
+  void QueryShared(const cv::Rect_<float> &rect, std::vector<int> &out) const;
+
+ private:
+  void CellRange(const cv::Rect_<float> &rect, int &x0, int &y0, int &x1,
+                 int &y1) const;
+
+  float x_min_ = 0.f;
+  float y_min_ = 0.f;
+  float inv_cell_w_ = 1.f;
+  float inv_cell_h_ = 1.f;
+  int cols_ = 0;
+  int rows_ = 0;
+  std::vector<int> cell_start_;
+  std::vector<int> cell_items_;
+  std::vector<int> cell_fill_;
+  // query stamp per box, avoids reporting a box once per shared cell
+  std::vector<unsigned> seen_;
+  unsigned stamp_ = 0;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -0,0 +1,169 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_lap.hpp"
+#include <glog/logging.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace vitis {
+namespace ai {
+
+static const double kInf = std::numeric_limits<double>::infinity();
+
+double FtdLapSolver::Solve(const std::vector<std::vector<double>> &DistMatrix,
+                           std::vector<int> &Assignment) {
+  if (DistMatrix.empty()) {
+    Assignment.clear();
+    return 0.0;
+  }
+  int rows = DistMatrix.size();
+  int cols = DistMatrix[0].size();
+  flat_.resize(rows * cols);
+  for (int i = 0; i < rows; i++) {
+    std::copy(DistMatrix[i].begin(), DistMatrix[i].end(),
+              flat_.begin() + i * cols);
+  }
+  return Solve(flat_.data(), rows, cols, cols, Assignment);
+}
+
+double FtdLapSolver::Solve(const double *cost, int rows, int cols, int ld,
+                           std::vector<int> &assignment) {
+  assignment.assign(rows, -1);
+  if (rows == 0 || cols == 0) return 0.0;
+  double total = 0.0;
+  if (rows <= cols) {
+    Run(cost, rows, cols, ld);
+    for (int i = 0; i < rows; i++) {
+      assignment[i] = col4row_[i];
+      total += cost[i * ld + col4row_[i]];
+    }
+  } else {
+    // solve the transposed problem so that every column gets a row; grow
+    // with slack, sub-problem shapes change from frame to frame
+    if ((int)transposed_.capacity() < rows * cols)
+      transposed_.reserve(2 * rows * cols);
+    transposed_.resize(rows * cols);
+    for (int i = 0; i < rows; i++)
+      for (int j = 0; j < cols; j++)
+        transposed_[j * rows + i] = cost[i * ld + j];
+    Run(transposed_.data(), cols, rows, rows);
+    for (int j = 0; j < cols; j++) {
+      assignment[col4row_[j]] = j;
+      total += cost[col4row_[j] * ld + j];
+    }
+  }
+  return total;
+}
+
+void FtdLapSolver::Reserve(int rows, int cols) {
+  size_t n = std::max(rows, cols);
+  u_.reserve(n);
+  v_.reserve(n);
+  shortest_.reserve(n);
+  path_.reserve(n);
+  col4row_.reserve(n);
+  row4col_.reserve(n);
+  remaining_.reserve(n);
+  sr_.reserve(n);
+  sc_.reserve(n);
+}
+
+void FtdLapSolver::Run(const double *cost, int nr, int nc, int ld) {
+  u_.assign(nr, 0.0);
+  v_.assign(nc, 0.0);
+  shortest_.resize(nc);
+  path_.assign(nc, -1);
+  col4row_.assign(nr, -1);
+  row4col_.assign(nc, -1);
+  remaining_.resize(nc);
+  sr_.resize(nr);
+  sc_.resize(nc);
+
+  for (int cur_row = 0; cur_row < nr; cur_row++) {
+    double min_val;
+    int sink = AugmentingPath(cost, nc, ld, cur_row, min_val);
+    CHECK(sink >= 0) << "cost matrix is infeasible";
+
+    // update dual variables
+    u_[cur_row] += min_val;
+    for (int i = 0; i < nr; i++) {
+      if (sr_[i] && i != cur_row) u_[i] += min_val - shortest_[col4row_[i]];
+    }
+    for (int j = 0; j < nc; j++) {
+      if (sc_[j]) v_[j] -= min_val - shortest_[j];
+    }
+
+    // augment previous solution
+    int j = sink;
+    while (true) {
+      int i = path_[j];
+      row4col_[j] = i;
+      std::swap(col4row_[i], j);
+      if (i == cur_row) break;
+    }
+  }
+}
+
+int FtdLapSolver::AugmentingPath(const double *cost, int nc, int ld, int row,
+                                 double &min_val) {
+  min_val = 0;
+  // columns are scanned from the last one, as in Crouse's implementation
+  int num_remaining = nc;
+  for (int it = 0; it < nc; it++) remaining_[it] = nc - it - 1;
+  std::fill(sr_.begin(), sr_.end(), 0);
+  std::fill(sc_.begin(), sc_.end(), 0);
+  std::fill(shortest_.begin(), shortest_.end(), kInf);
+
+  int i = row;
+  int sink = -1;
+  while (sink == -1) {
+    int index = -1;
+    double lowest = kInf;
+    sr_[i] = 1;
+    const double *cost_row = cost + i * ld;
+    for (int it = 0; it < num_remaining; it++) {
+      int j = remaining_[it];
+      double r = min_val + cost_row[j] - u_[i] - v_[j];
+      if (r < shortest_[j]) {
+        path_[j] = i;
+        shortest_[j] = r;
+      }
+      // prefer a free column on ties, it ends the search
+      if (shortest_[j] < lowest ||
+          (shortest_[j] == lowest && row4col_[j] == -1)) {
+        lowest = shortest_[j];
+        index = it;
+      }
+    }
+    min_val = lowest;
+    if (min_val == kInf) return -1;
+
+    int j = remaining_[index];
+    if (row4col_[j] == -1) {
+      sink = j;
+    } else {
+      i = row4col_[j];
+    }
+    sc_[j] = 1;
+    remaining_[index] = remaining_[--num_remaining];
+  }
+  return sink;
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+namespace vitis {
+namespace ai {
+
+/// Linear assignment solver (Jonker-Volgenant style shortest augmenting
+/// path, rectangular variant by Crouse).
+///
+/// Drop-in replacement for FtdHungarian: for a rows x cols cost matrix every
+/// row is assigned when rows <= cols, otherwise every column is, and
+/// unassigned rows get -1. All working memory lives in the solver and is
+/// reused, so solving matrices no larger than previous ones does not touch
+/// the heap. FtdHungarian is kept as the reference implementation.
+class FtdLapSolver {
+ public:
+  FtdLapSolver(){};
+  ~FtdLapSolver(){};
+
+  /// cost is row-major with leading dimension ld. Returns the total cost.
+  double Solve(const double *cost, int rows, int cols, int ld,
+               std::vector<int> &assignment);
+  /// Same interface as FtdHungarian::Solve.
+  double Solve(const std::vector<std::vector<double>> &DistMatrix,
+               std::vector<int> &Assignment);
+  /// Sizes the per row / per column workspace for any problem up to rows x
+  /// cols, so solving sub-problems of varying shape does not allocate.
+  void Reserve(int rows, int cols);
+
+ private:
+  // requires nr <= nc
+  void Run(const double *cost, int nr, int nc, int ld);
+  int AugmentingPath(const double *cost, int nc, int ld, int row,
+                     double &min_val);
+
+  std::vector<double> flat_;
+  std::vector<double> transposed_;
+  std::vector<double> u_;
+  std::vector<double> v_;
+  std::vector<double> shortest_;
+  std::vector<int> path_;
+  std::vector<int> col4row_;
+  std::vector<int> row4col_;
+  std::vector<int> remaining_;
+  std::vector<char> sr_;
+  std::vector<char> sc_;
+};
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "ftd_snapshot.hpp"
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+
+namespace vitis {
+namespace ai {
+
+FTD_SnapshotFile::FTD_SnapshotFile(const std::string &path)
+    : path_(path), busy_(false), stop_(false) {
+  thread_ = std::thread(&FTD_SnapshotFile::Run, this);
+}
+
+FTD_SnapshotFile::~FTD_SnapshotFile() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+bool FTD_SnapshotFile::Submit(std::vector<char> &image) {
+  // the writer holds the lock only to flip busy_, never while writing
+  std::unique_lock<std::mutex> lock(mtx_, std::try_to_lock);
+  if (!lock.owns_lock() || busy_) return false;
+  pending_.swap(image);
+  busy_ = true;
+  lock.unlock();
+  cv_.notify_one();
+  return true;
+}
+
+void FTD_SnapshotFile::Run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    cv_.wait(lock, [this] { return busy_ || stop_; });
+    if (busy_) {
+      lock.unlock();
+      Write(path_, pending_);
+      lock.lock();
+      busy_ = false;
+    }
+    if (stop_) break;
+  }
+}
+
+bool FTD_SnapshotFile::Write(const std::string &path,
+                             const std::vector<char> &image) {
+  std::string tmp = path + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) {
+    LOG(WARNING) << "fail to open snapshot " << tmp;
+    return false;
+  }
+  bool ok = fwrite(image.data(), 1, image.size(), fp) == image.size();
+  ok = fflush(fp) == 0 && ok;
+  ok = fsync(fileno(fp)) == 0 && ok;
+  ok = fclose(fp) == 0 && ok;
+  ok = ok && rename(tmp.c_str(), path.c_str()) == 0;
+  LOG_IF(WARNING, !ok) << "fail to write snapshot " << path;
+  return ok;
+}
+
+FTD_MappedFile::FTD_MappedFile(const std::string &path)
+    : data_(nullptr), size_(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      data_ = (const char *)p;
+      size_ = st.st_size;
+    }
+  }
+  close(fd);
+}
+
+FTD_MappedFile::~FTD_MappedFile() {
+  if (data_) munmap((void *)data_, size_);
+}
+
+}  // namespace ai
+}  // namespace vitis
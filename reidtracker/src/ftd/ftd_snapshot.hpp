@@ -0,0 +1,147 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _FTD_SNAPSHOT_HPP_
+#define _FTD_SNAPSHOT_HPP_
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+
+/// Appends values to a byte image of tracker state, see FTD_Structure::Save.
+///
+/// Values are copied in host representation; the image header written by
+/// FTD_Structure carries a format version and a byte order mark, so a stale
+/// or foreign image is rejected instead of misread. The image vector is
+/// cleared but keeps its capacity, so saving again does not allocate.
+class FTD_SnapshotOut {
+ public:
+  explicit FTD_SnapshotOut(std::vector<char> &image) : image_(image) {
+    image_.clear();
+  }
+  void Put(const void *data, size_t size) {
+    const char *p = (const char *)data;
+    image_.insert(image_.end(), p, p + size);
+  }
+  template <typename T>
+  void Put(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshot values are copied bytewise");
+    Put(&value, sizeof(T));
+  }
+
+ private:
+  std::vector<char> &image_;
+};
+
+/// Reads values back from an image, bounds checked: reading past the end
+/// copies nothing and turns ok() false for good, so a truncated image is
+/// detected by one test at the end.
+class FTD_SnapshotIn {
+ public:
+  FTD_SnapshotIn(const char *data, size_t size)
+      : p_(data), end_(data + size), ok_(true) {}
+  bool ok() const { return ok_; }
+  /// Whether every byte of the image was read.
+  bool at_end() const { return p_ == end_; }
+  bool Get(void *data, size_t size) {
+    if (!ok_ || (size_t)(end_ - p_) < size) return ok_ = false;
+    std::memcpy(data, p_, size);
+    p_ += size;
+    return true;
+  }
+  template <typename T>
+  bool Get(T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "snapshot values are copied bytewise");
+    return Get(&value, sizeof(T));
+  }
+  /// Reads a bool saved with Put, through its byte: any byte but 0 or 1 is
+  /// not a bool and fails the image.
+  bool GetBool(bool &value) {
+    unsigned char byte = 0;
+    if (!Get(byte)) return false;
+    if (byte > 1) return ok_ = false;
+    value = byte == 1;
+    return true;
+  }
+  /// Marks the image as invalid, for values that are read but not accepted.
+  void Fail() { ok_ = false; }
+
+ private:
+  const char *p_;
+  const char *end_;
+  bool ok_;
+};
+
+/// Writes snapshot images to a file from a background thread.
+///
+/// Submit hands an image over by swapping buffers and never waits: if the
+/// previous image is still being written it returns false and the caller
+/// keeps its image. The file is written as path.tmp and renamed, so readers
+/// only ever see a complete snapshot.
+class FTD_SnapshotFile {
+ public:
+  explicit FTD_SnapshotFile(const std::string &path);
+  /// Writes the pending image, if any, before returning.
+  ~FTD_SnapshotFile();
+  FTD_SnapshotFile(const FTD_SnapshotFile &) = delete;
+  FTD_SnapshotFile &operator=(const FTD_SnapshotFile &) = delete;
+
+  const std::string &path() const { return path_; }
+  bool Submit(std::vector<char> &image);
+  /// Writes image to path from the calling thread.
+  static bool Write(const std::string &path, const std::vector<char> &image);
+
+ private:
+  void Run();
+  std::string path_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  // the image being handed over, owned by the writer while busy_
+  std::vector<char> pending_;
+  bool busy_;
+  bool stop_;
+  std::thread thread_;
+};
+
+/// Read-only memory map of a snapshot file; empty if it can not be mapped.
+class FTD_MappedFile {
+ public:
+  explicit FTD_MappedFile(const std::string &path);
+  ~FTD_MappedFile();
+  FTD_MappedFile(const FTD_MappedFile &) = delete;
+  FTD_MappedFile &operator=(const FTD_MappedFile &) = delete;
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char *data_;
+  size_t size_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -15,30 +15,98 @@
  */
 
 #include "ftd_structure.hpp"
+#include <cstring>
 #include <glog/logging.h>
 #include "../common.hpp"
 
 using namespace cv;
 using namespace std;
 
+// Gated association: only detections overlapping the predicted box grown by
+// REID_TRACKER_GATE percent of its size on every side are candidates, and
+// every connected group of candidates is solved on its own. 0 disables it.
+DEF_ENV_PARAM(REID_TRACKER_GATE, "0")
+// Cascade association: pairs overlapping by at least REID_TRACKER_CASCADE
+// percent iou with no competing overlap are matched on geometry alone, and
+// appearance distances are only computed for what is left. 0 disables it;
+// it applies to the ungated association only.
+DEF_ENV_PARAM(REID_TRACKER_CASCADE, "0")
+// Storage of the trajectory embeddings: 32 (float), 16 (FP16) or 8 (INT8
+// with a per vector scale), see FTD_Gallery.
+DEF_ENV_PARAM(REID_TRACKER_FEAT_BITS, "32")
+// Appearance memory of a track: number of exemplars, the distance (in
+// hundredths) a matched feature must be from all of them to be kept, and a
+// bound on the feature memory of one track in KiB (0: no bound).
+DEF_ENV_PARAM(REID_TRACKER_EXEMPLARS, "1")
+DEF_ENV_PARAM(REID_TRACKER_EXEMPLAR_NOVELTY, "30")
+DEF_ENV_PARAM(REID_TRACKER_TRACK_FEAT_KB, "0")
+// Capacity of the track event ring (see PopEvents), 0 disables the events.
+DEF_ENV_PARAM(REID_TRACKER_EVENTS, "1024")
+// Frames with at least this many track x detection pairs build their iou,
+// center and appearance matrices in parallel, split by rows, on a pool of
+// REID_TRACKER_THREADS threads shared by the trackers of the process (0
+// disables it, it is capped to the hardware threads less one). Smaller
+// frames are not worth the hand-off.
+DEF_ENV_PARAM(REID_TRACKER_PARALLEL_PAIRS, "2048")
+DEF_ENV_PARAM(REID_TRACKER_THREADS, "3")
+
+// snapshot image header, see Save
+static const char kSnapshotMagic[4] = {'F', 'T', 'D', 'S'};
+static const uint32_t kSnapshotVersion = 1;
+static const uint32_t kSnapshotByteOrder = 0x01020304;
+
 namespace vitis {
 namespace ai {
 
-FTD_Structure::FTD_Structure(const SpecifiedCfg& specified_cfg) {
+// Created on the first tracker that uses it, lives as long as the process;
+// never more threads than the hardware runs besides the caller.
+static FTD_Workers* SharedWorkers() {
+  static FTD_Workers workers(
+      std::max(std::min<int>(ENV_PARAM(REID_TRACKER_THREADS),
+                             std::thread::hardware_concurrency() - 1),
+               0));
+  return &workers;
+}
+
+FTD_Structure::FTD_Structure(const SpecifiedCfg& specified_cfg)
+    : events_(std::max(ENV_PARAM(REID_TRACKER_EVENTS), 0)), publish_(false) {
   CHECK(id_record.empty()) << "id_record must be empty when initial";
   id_record.push_back(0);
   track_id = 1;
+  frame_id_ = 0;
+  snapshot_period_ = 0;
   iou_threshold = 0.3f;
   feat_distance_low = 0.8f;
   feat_distance_high = 1.0f;
   score_threshold = 0.f;
   specified_cfg_ = specified_cfg;
+  use_kalman_ = FTD_KalmanModels::Selected(specified_cfg);
+  gate_ = ENV_PARAM(REID_TRACKER_GATE);
+  cascade_ = ENV_PARAM(REID_TRACKER_CASCADE);
+  parallel_pairs_ = ENV_PARAM(REID_TRACKER_PARALLEL_PAIRS);
+  workers_ = nullptr;
+  if (ENV_PARAM(REID_TRACKER_THREADS) > 0 && parallel_pairs_ > 0) {
+    workers_ = SharedWorkers();
+    if (workers_->size() == 1) workers_ = nullptr;
+  }
+  if (workers_) part_candidates_.resize(workers_->size());
+  ConfigureGallery();
+}
+
+void FTD_Structure::ConfigureGallery() {
+  gallery_.SetBits(ENV_PARAM(REID_TRACKER_FEAT_BITS));
+  gallery_.SetExemplars(ENV_PARAM(REID_TRACKER_EXEMPLARS),
+                        ENV_PARAM(REID_TRACKER_EXEMPLAR_NOVELTY) / 100.f,
+                        ENV_PARAM(REID_TRACKER_TRACK_FEAT_KB) * 1024);
 }
 
 FTD_Structure::~FTD_Structure() { this->clear(); }
 
 void FTD_Structure::clear() {
-  tracks.clear();
+  for (auto t : tracks) {
+    events_.Push(TrackEvent::REMOVED, frame_id_, t->GetId(), -1);
+  }
+  DropTracks();
   id_record.clear();
   track_id = 1;
   remove_id_this_frame.clear();
@@ -58,18 +126,6 @@ double get_euro_dis(Mat feat1, Mat feat2) {
   return sqrt(sumvalue);
 }
 
-void FindRemain(std::vector<int>& input, std::vector<int>& output, int len) {
-  output.clear();
-  for (int i = 0; i < len; i++) {
-    if (input.empty() ||
-        std::find(input.begin(), input.end(), i) == input.end()) {
-      output.push_back(i);
-    }
-  }
-  CHECK((int)(input.size() + output.size()) == len)
-      << "error happen in function FindRemain";
-}
-
 float GetIou(const cv::Rect_<float>& rect1, const cv::Rect_<float>& rect2) {
   float inner = (rect1 & rect2).area();
   float univer = rect1.area() + rect2.area() - inner;
@@ -91,233 +147,879 @@ float GetCoverRatio(const cv::Rect_<float>& rect1,
   return (inner / rect1.area());
 }
 
-void FTD_Structure::GetOut(std::vector<OutputCharact>& output_characts) {
+void FTD_Structure::GetOut(std::vector<OutputCharact>& output_characts,
+                           DetectResult* detect_results) {
   CHECK(output_characts.size() == 0) << "error output_characts size";
-  if(tracks.empty()) return;
-  for (auto ti = tracks.end() - 1; ti >= tracks.begin();) {
-    if ((((*ti)->time_since_update) < 1) &&
-        //(((*ti)->hit_streak >= (*ti)->time_since_update) || frame_count <= min_hits)) {
-        (((*ti)->hit_streak >= min_hits) || frame_count <= min_hits)) {
-      auto id = (*ti) -> GetId();
+  // backwards, so a removed track is replaced by one already visited
+  for (size_t i = tracks.size(); i-- > 0;) {
+    auto ti = tracks[i];
+    bool shown = false;
+    if (((ti->time_since_update) < 1) &&
+        //((ti->hit_streak >= ti->time_since_update) || frame_count <= min_hits)) {
+        ((ti->hit_streak >= min_hits) || frame_count <= min_hits)) {
+      auto id = ti->GetId();
       if(id == 0u) {
-	(*ti) -> SetId(track_id);
+	ti->SetId(track_id);
+        events_.Push(TrackEvent::CONFIRMED, frame_id_, track_id,
+                     std::get<4>(ti->GetCharact()));
         track_id++;
       }
-      auto oout = (*ti)->GetOut();
+      auto oout = ti->GetOut();
       output_characts.push_back(oout);
+      shown = true;
+    }
+    if (detect_results && ti->detect_index >= 0) {
+      auto& result = detect_results[ti->detect_index];
+      result.bbox = std::get<1>(ti->GetOut());
+      result.gid = shown ? ti->GetId() : 0u;
+      result.state = shown ? DetectResult::TRACKED : DetectResult::TENTATIVE;
+    }
+    if (ti->time_since_update > max_age) {
+      RemoveTrack(i);
+    }
+  }
+}
+
+void FTD_Structure::RemoveTrack(size_t index) {
+  uint64_t gid = tracks[index]->GetId();
+  events_.Push(TrackEvent::REMOVED, frame_id_, gid, -1);
+  if (gid != 0u) remove_id_this_frame.push_back(gid);
+  size_t last = tracks.size() - 1;
+  pool_.Release(tracks[index]);
+  if (index != last) {
+    tracks[index] = tracks[last];
+    if (use_kalman_) {
+      kalman_.Move(last, index);
+    } else {
+      models_.Move(last, index);
+      tracks[index]->Bind(&models_, index);
+    }
+  }
+  tracks.pop_back();
+  ResizeMotion(last);
+}
+
+void FTD_Structure::DropTracks() {
+  for (auto t : tracks) pool_.Release(t);
+  tracks.clear();
+  ResizeMotion(0);
+  gallery_.Clear();
+}
+
+void FTD_Structure::Save(std::vector<char>& image) const {
+  FTD_SnapshotOut out(image);
+  out.Put(kSnapshotMagic);
+  out.Put(kSnapshotVersion);
+  out.Put(kSnapshotByteOrder);
+  out.Put(use_kalman_);
+  gallery_.SaveFormat(out);
+  out.Put(frame_count);
+  out.Put(track_id);
+  out.Put(frame_id_);
+  out.Put((uint64_t)id_record.size());
+  out.Put(id_record.data(), id_record.size() * sizeof(uint64_t));
+  out.Put((uint64_t)tracks.size());
+  for (size_t i = 0; i < tracks.size(); ++i) {
+    if (use_kalman_) kalman_.Save(out, i);
+    tracks[i]->Save(out);
+  }
+}
+
+bool FTD_Structure::Restore(const char* data, size_t size) {
+  clear();
+  FTD_SnapshotIn in(data, size);
+  char magic[4] = {0};
+  uint32_t version = 0, byte_order = 0;
+  bool kalman = false;
+  in.Get(magic);
+  in.Get(version);
+  in.Get(byte_order);
+  in.GetBool(kalman);
+  if (!in.ok() || std::memcmp(magic, kSnapshotMagic, 4) != 0 ||
+      version != kSnapshotVersion || byte_order != kSnapshotByteOrder ||
+      kalman != use_kalman_) {
+    LOG(WARNING) << "snapshot is not a version " << kSnapshotVersion
+                 << " image of this build and motion model";
+    return false;
+  }
+  int count = 0;
+  uint64_t next_id = 0, last_frame = 0, nid = 0, ntrack = 0;
+  // the format of the image fixes the dim of a gallery that had none
+  bool formatted = gallery_.dim() > 0;
+  gallery_.LoadFormat(in);
+  in.Get(count);
+  in.Get(next_id);
+  in.Get(last_frame);
+  // every record takes at least 8 bytes, larger counts are damage
+  if (in.Get(nid) && nid > 0 && nid <= size / 8) {
+    std::vector<uint64_t> ids(nid);
+    in.Get(ids.data(), nid * sizeof(uint64_t));
+    id_record.swap(ids);
+  } else {
+    in.Fail();
+  }
+  if (in.Get(ntrack) && ntrack > size / 8) in.Fail();
+  for (uint64_t k = 0; k < ntrack && in.ok(); ++k) {
+    tracks.push_back(pool_.Acquire(specified_cfg_, &gallery_));
+    int row = tracks.size() - 1;
+    ResizeMotion(row + 1);
+    if (use_kalman_)
+      kalman_.Load(in, row);
+    else
+      tracks.back()->Bind(&models_, row);
+    if (in.ok()) tracks.back()->Load(in);
+  }
+  // bytes left over mean the records were not read as they were written
+  if (!in.at_end()) in.Fail();
+  if (!in.ok()) {
+    LOG(WARNING) << "snapshot is truncated or damaged";
+    DropTracks();
+    id_record.assign(1, 0);
+    if (!formatted) {
+      gallery_ = FTD_Gallery();
+      ConfigureGallery();
+    }
+    return false;
+  }
+  frame_count = count;
+  track_id = next_id;
+  frame_id_ = last_frame;
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER))
+      << "restored " << tracks.size() << " tracks, next id " << track_id;
+  return true;
+}
+
+void FTD_Structure::SetSnapshot(const std::string& path, int period) {
+  // the previous writer finishes its last image
+  snapshot_.reset();
+  snapshot_period_ = period;
+  if (period > 0) snapshot_.reset(new FTD_SnapshotFile(path));
+}
+
+void FTD_Structure::AutoSnapshot() {
+  if (!snapshot_ || frame_count % snapshot_period_ != 0) return;
+  // the copy is made here, the file is written by the writer thread; if it
+  // is still busy with the last image this one is skipped
+  Save(snapshot_image_);
+  if (!snapshot_->Submit(snapshot_image_)) {
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER))
+        << "snapshot writer busy, frame " << frame_id_ << " skipped";
+  }
+}
+
+void FTD_Structure::ResizeMotion(int rows) {
+  if (use_kalman_)
+    kalman_.Resize(rows);
+  else
+    models_.Resize(rows);
+}
+
+void FTD_Structure::Associate(int ntrack, int ndet, const double* neg_iou,
+                              double* feat, const double* center,
+                              std::vector<int>& match_track,
+                              std::vector<int>& match_detect) {
+  if (ntrack == 0 || ndet == 0) return;
+  const double masked = feat_distance_high + 1.0f;
+  auto mask_match = [&](int t, int d) {
+    for (int i = 0; i < ntrack; i++) feat[i * ndet + d] = masked;
+    for (int j = 0; j < ndet; j++) feat[t * ndet + j] = masked;
+  };
+  size_t first = match_track.size();
+
+  lap_.Solve(neg_iou, ntrack, ndet, ndet, assignment_);
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "assign size: " << assignment_.size();
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "iou: ";
+  for (unsigned int x = 0; x < assignment_.size(); x++)
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << assignment_[x];
+  // greedy find match track and detect number
+  for (int t = 0; t < ntrack; t++) {
+    int d = assignment_[t];
+    if (d == -1) continue;
+    double& fd = feat[t * ndet + d];
+    if (((1.0f - neg_iou[t * ndet + d]) >= iou_threshold) &&
+        (fd < feat_distance_low - 0.1)) {
+      match_track.push_back(t);
+      match_detect.push_back(d);
+      mask_match(t, d);
+    }
+    if ((1.0f - neg_iou[t * ndet + d] >= iou_threshold) &&
+        (fd > feat_distance_high)) {
+      fd = masked;
+    }
+  }
+  int iou_matched = match_track.size() - first;
+
+  lap_.Solve(feat, ntrack, ndet, ndet, assignment_);
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "feats: ";
+  for (unsigned int x = 0; x < assignment_.size(); x++)
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << assignment_[x];
+  for (int t = 0; t < ntrack; t++) {
+    int d = assignment_[t];
+    if (d == -1) continue;
+    if (feat[t * ndet + d] < feat_distance_low) {
+      match_track.push_back(t);
+      match_detect.push_back(d);
+      mask_match(t, d);
+    }
+  }
+
+  // the center gated pass only runs if the iou pass left both sides unmatched
+  if (iou_matched < ntrack && iou_matched < ndet) {
+    for (int i = 0; i < ntrack * ndet; ++i) {
+      if (!center[i]) feat[i] = masked;
+    }
+    lap_.Solve(feat, ntrack, ndet, ndet, assignment_);
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "feats2: ";
+    for (unsigned int x = 0; x < assignment_.size(); x++)
+      LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << assignment_[x];
+    for (int t = 0; t < ntrack; t++) {
+      int d = assignment_[t];
+      if (d == -1) continue;
+      if (feat[t * ndet + d] < feat_distance_high) {
+        match_track.push_back(t);
+        match_detect.push_back(d);
+      }
+    }
+  }
+}
+
+void FTD_Structure::MaskLabels(int ntrack, int ndet, const int* track_index,
+                               const int* detect_index, double* feat) {
+  auto track_label = [&](int i) {
+    return std::get<3>(tracks[track_index ? track_index[i] : i]->GetCharact());
+  };
+  auto detect_label = [&](int j) {
+    return detections_[detect_index ? detect_index[j] : j]->label;
+  };
+  if (ntrack == 0 || ndet == 0) return;
+  // nothing to do in the common case of a single label
+  int label = detect_label(0);
+  bool single = true;
+  for (int i = 0; i < ntrack && single; ++i) single = track_label(i) == label;
+  for (int j = 0; j < ndet && single; ++j) single = detect_label(j) == label;
+  if (single) return;
+  for (int i = 0; i < ntrack; ++i) {
+    int label_t = track_label(i);
+    for (int j = 0; j < ndet; ++j) {
+      if (detect_label(j) != label_t) feat[i * ndet + j] = 2.0;
+    }
+  }
+}
+
+void FTD_Structure::AssociateCascade(int ntrack, int ndet,
+                                     std::vector<int>& match_track,
+                                     std::vector<int>& match_detect) {
+  if (ntrack == 0 || ndet == 0) return;
+  // a pair is confident if it overlaps by the cascade iou and neither side
+  // reaches the iou threshold with anything else
+  double confident = 1.0 - cascade_ / 100.0;
+  double overlap = 1.0 - iou_threshold;
+  track_hits_.assign(ntrack, 0);
+  detect_hits_.assign(ndet, 0);
+  for (int i = 0; i < ntrack; ++i) {
+    for (int j = 0; j < ndet; ++j) {
+      if (iou_mat_[i * ndet + j] > overlap) continue;
+      track_hits_[i]++;
+      detect_hits_[j]++;
+    }
+  }
+  rest_track_.clear();
+  rest_detect_.clear();
+  detect_matched_.assign(ndet, 0);
+  for (int i = 0; i < ntrack; ++i) {
+    int d = -1;
+    if (track_hits_[i] == 1) {
+      for (int j = 0; j < ndet && d < 0; ++j) {
+        if (iou_mat_[i * ndet + j] <= confident && detect_hits_[j] == 1) d = j;
+      }
+    }
+    if (d < 0) {
+      rest_track_.push_back(i);
+      continue;
+    }
+    match_track.push_back(i);
+    match_detect.push_back(d);
+    detect_matched_[d] = 1;
+  }
+  for (int j = 0; j < ndet; ++j) {
+    if (!detect_matched_[j]) rest_detect_.push_back(j);
+  }
+  int nt = rest_track_.size(), nd = rest_detect_.size();
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER))
+      << "cascade: " << match_track.size() << " confident, " << nt << "x" << nd
+      << " left";
+  if (nt == 0 || nd == 0) return;
+
+  // the rest keeps its geometry: the indices only grow, so the block is
+  // compacted in place
+  for (int a = 0; a < nt; ++a) {
+    for (int b = 0; b < nd; ++b) {
+      int from = rest_track_[a] * ndet + rest_detect_[b];
+      iou_mat_[a * nd + b] = iou_mat_[from];
+      center_mat_[a * nd + b] = center_mat_[from];
+    }
+  }
+  // appearance for the rest only; when most of the frame is left the
+  // batched pass over the gallery is cheaper than pair by pair
+  feat_mat_.resize(nt * nd);
+  bool batched = 2 * nt * nd >= gallery_.rows() * ndet;
+  if (batched) {
+    dot_buf_.resize(gallery_.rows() * ndet);
+    gallery_.QueryDotMatrix(dot_buf_.data(), ndet);
+  }
+  for (int a = 0; a < nt; ++a) {
+    int slot = tracks[rest_track_[a]]->GetSlot();
+    for (int b = 0; b < nd; ++b) {
+      double cdis =
+          batched ? FeatUnitDistance(dot_buf_[slot * ndet + rest_detect_[b]])
+                  : gallery_.QueryDistance(slot, rest_detect_[b]);
+      feat_mat_[a * nd + b] = cdis < 2.0 ? cdis : 2.0;
+    }
+  }
+  MaskLabels(nt, nd, rest_track_.data(), rest_detect_.data(),
+             feat_mat_.data());
+  size_t first = match_track.size();
+  Associate(nt, nd, iou_mat_.data(), feat_mat_.data(), center_mat_.data(),
+            match_track, match_detect);
+  for (size_t m = first; m < match_track.size(); ++m) {
+    match_track[m] = rest_track_[match_track[m]];
+    match_detect[m] = rest_detect_[match_detect[m]];
+  }
+}
+
+static int FindRoot(std::vector<int>& parent, int x) {
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+void FTD_Structure::AssociateGated(std::vector<int>& match_track,
+                                   std::vector<int>& match_detect) {
+  int ntrack = tracks.size();
+  int ndet = detections_.size();
+  if (ntrack == 0 || ndet == 0) return;
+  float grow = gate_ / 100.f;
+
+  // candidate pairs: same label and detection inside the grown prediction
+  grid_boxes_.clear();
+  for (auto& t : tracks) {
+    auto rect_t = std::get<1>(t->GetCharact());
+    grid_boxes_.emplace_back(rect_t.x - rect_t.width * grow,
+                             rect_t.y - rect_t.height * grow,
+                             rect_t.width * (1.f + 2.f * grow),
+                             rect_t.height * (1.f + 2.f * grow));
+  }
+  grid_.Build(grid_boxes_);
+  edges_.clear();
+  for (int j = 0; j < ndet; ++j) {
+    auto rect_i = detections_[j]->bbox;
+    auto label_i = detections_[j]->label;
+    candidates_.clear();
+    grid_.Query(rect_i, candidates_);
+    for (int i : candidates_) {
+      auto rect_t = std::get<1>(tracks[i]->GetCharact());
+      if (std::get<3>(tracks[i]->GetCharact()) != label_i) continue;
+      if ((grid_boxes_[i] & rect_i).area() <= 0.f) continue;
+      int slot = tracks[i]->GetSlot();
+      Edge e;
+      e.track = i;
+      e.det = j;
+      e.neg_iou = 1.0f - GetIou(rect_t, rect_i);
+      e.center = GetCenterDis(rect_i, rect_t);
+      double cdis = gallery_.QueryDistance(slot, j);
+      e.feat = cdis < 2.0 ? cdis : 2.0;
+      edges_.push_back(e);
+    }
+  }
+
+  // connected components of the candidate graph, tracks are nodes
+  // [0, ntrack) and detections [ntrack, ntrack + ndet)
+  int nnode = ntrack + ndet;
+  parent_.resize(nnode);
+  for (int n = 0; n < nnode; ++n) parent_[n] = n;
+  for (auto& e : edges_) {
+    int a = FindRoot(parent_, e.track);
+    int b = FindRoot(parent_, ntrack + e.det);
+    if (a != b) parent_[a] = b;
+  }
+  // flatten so parent_ holds the root of every node, then bucket nodes and
+  // edges by root keeping the original order inside each component
+  for (int n = 0; n < nnode; ++n) parent_[n] = FindRoot(parent_, n);
+  comp_node_start_.assign(nnode + 1, 0);
+  comp_edge_start_.assign(nnode + 1, 0);
+  for (int n = 0; n < nnode; ++n) comp_node_start_[parent_[n] + 1]++;
+  for (auto& e : edges_) comp_edge_start_[parent_[e.track] + 1]++;
+  for (int n = 0; n < nnode; ++n) {
+    comp_node_start_[n + 1] += comp_node_start_[n];
+    comp_edge_start_[n + 1] += comp_edge_start_[n];
+  }
+  comp_nodes_.resize(nnode);
+  comp_edges_.reserve(edges_.capacity());
+  comp_edges_.resize(edges_.size());
+  comp_fill_.assign(comp_node_start_.begin(), comp_node_start_.end() - 1);
+  for (int n = 0; n < nnode; ++n) {
+    comp_nodes_[comp_fill_[parent_[n]]++] = n;
+  }
+  comp_fill_.assign(comp_edge_start_.begin(), comp_edge_start_.end() - 1);
+  for (size_t k = 0; k < edges_.size(); ++k) {
+    comp_edges_[comp_fill_[parent_[edges_[k].track]]++] = k;
+  }
+  local_index_.resize(nnode);
+  // components are never larger than the whole frame
+  lap_.Reserve(ntrack, ndet);
+  assignment_.reserve(std::max(ntrack, ndet));
+
+  int solved = 0;
+  for (int root = 0; root < nnode; ++root) {
+    int eb = comp_edge_start_[root], ee = comp_edge_start_[root + 1];
+    if (eb == ee) continue;  // isolated track or detection
+    if (ee - eb == 1) {
+      // a single candidate pair needs no solver, the three passes reduce to
+      // their acceptance tests
+      const Edge& e = edges_[comp_edges_[eb]];
+      bool iou_ok = (1.0f - e.neg_iou) >= iou_threshold;
+      if ((iou_ok && e.feat < feat_distance_low - 0.1) ||
+          e.feat < feat_distance_low ||
+          (e.center && e.feat < feat_distance_high)) {
+        match_track.push_back(e.track);
+        match_detect.push_back(e.det);
+      }
+      continue;
     }
-    if ((*ti)->time_since_update > max_age) {
-      ti = tracks.erase(ti);
+    int nt = 0, nd = 0;
+    for (int k = comp_node_start_[root]; k < comp_node_start_[root + 1]; ++k) {
+      int n = comp_nodes_[k];
+      if (n < ntrack) {
+        local_index_[n] = nt++;
+      } else {
+        local_index_[n] = nd++;
+      }
+    }
+    // pairs outside the gate can never be accepted by any pass; the blocks
+    // grow with slack since component shapes change every frame
+    if ((int)iou_mat_.capacity() < nt * nd) {
+      iou_mat_.reserve(2 * nt * nd);
+      feat_mat_.reserve(2 * nt * nd);
+      center_mat_.reserve(2 * nt * nd);
+    }
+    iou_mat_.assign(nt * nd, 1.0);
+    feat_mat_.assign(nt * nd, feat_distance_high + 1.0f);
+    center_mat_.assign(nt * nd, 0.0);
+    for (int k = eb; k < ee; ++k) {
+      const Edge& e = edges_[comp_edges_[k]];
+      int idx = local_index_[e.track] * nd + local_index_[ntrack + e.det];
+      iou_mat_[idx] = e.neg_iou;
+      feat_mat_[idx] = e.feat;
+      center_mat_[idx] = e.center;
     }
-    ti--;
+    size_t first = match_track.size();
+    Associate(nt, nd, iou_mat_.data(), feat_mat_.data(), center_mat_.data(),
+              match_track, match_detect);
+    // back to frame indices: local indices follow node order
+    for (size_t m = first; m < match_track.size(); ++m) {
+      match_track[m] = comp_nodes_[comp_node_start_[root] + match_track[m]];
+      match_detect[m] =
+          comp_nodes_[comp_node_start_[root] + nt + match_detect[m]] - ntrack;
+    }
+    solved++;
   }
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER))
+      << "gated: " << edges_.size() << " candidate pairs, " << solved
+      << " components solved";
 }
 
 std::vector<OutputCharact> FTD_Structure::Update(
     uint64_t frame_id, bool detect_flag, int mode,
     std::vector<InputCharact>& input_characts) {
+  std::vector<OutputCharact> output_characts;
+  Update(frame_id, detect_flag, mode, input_characts, output_characts);
+  return output_characts;
+}
+
+void FTD_Structure::Update(uint64_t frame_id, bool detect_flag, int mode,
+                           std::vector<InputCharact>& input_characts,
+                           std::vector<OutputCharact>& output_characts,
+                           const FTD_Prepared* prepared) {
+  MakeDetections(input_characts, detect_buf_);
+  // the prepared frame must have seen the same detections
+  if (prepared) {
+    bool same = prepared->detections.size() == detect_buf_.size();
+    for (size_t k = 0; same && k < detect_buf_.size(); ++k) {
+      same = prepared->detections[k].feat == detect_buf_[k].feat &&
+             prepared->detections[k].local_id == detect_buf_[k].local_id;
+    }
+    LOG_IF(WARNING, !same) << "frame " << frame_id
+                           << " was prepared with other detections";
+    if (!same) prepared = nullptr;
+  }
+  Update(frame_id, detect_flag, mode, detect_buf_.data(), detect_buf_.size(),
+         output_characts, nullptr, prepared);
+}
+
+std::unique_ptr<FTD_Prepared> FTD_Structure::Prepare(
+    uint64_t frame_id, std::vector<InputCharact>& input_characts) {
+  publish_ = true;
+  std::unique_ptr<FTD_Prepared> prepared;
+  {
+    std::lock_guard<std::mutex> lock(prepared_mtx_);
+    if (!prepared_pool_.empty()) {
+      prepared = std::move(prepared_pool_.back());
+      prepared_pool_.pop_back();
+    }
+  }
+  if (!prepared) prepared.reset(new FTD_Prepared);
+  prepared->frame_id = frame_id;
+  prepared->dot.clear();
+  MakeDetections(input_characts, prepared->detections);
+  std::shared_ptr<FTD_Gallery> view;
+  {
+    std::lock_guard<std::mutex> lock(view_mtx_);
+    view = view_;
+  }
+  int ndet = prepared->detections.size();
+  // a private copy, only the slots changed since its last use are copied
+  auto& gallery = prepared->gallery;
+  if (view && view->dim() > 0 && ndet > 0) gallery.Sync(*view);
+  {
+    // dropped under the lock too, PublishView writes a view it holds alone
+    std::lock_guard<std::mutex> lock(view_mtx_);
+    view.reset();
+  }
+  if (gallery.dim() == 0 || ndet == 0) return prepared;
+  gallery.ResizeQueries(ndet);
+  for (int j = 0; j < ndet; ++j) {
+    auto& detect = prepared->detections[j];
+    if (detect.feat_dim != gallery.dim()) return prepared;
+    gallery.SetQuery(j, detect.feat);
+  }
+  prepared->dot.resize(gallery.rows() * ndet);
+  gallery.QueryDotMatrix(prepared->dot.data(), ndet);
+  return prepared;
+}
+
+void FTD_Structure::Recycle(std::unique_ptr<FTD_Prepared> prepared) {
+  std::lock_guard<std::mutex> lock(prepared_mtx_);
+  // enough for the detector threads of a process
+  if (prepared_pool_.size() < 16) prepared_pool_.push_back(std::move(prepared));
+}
+
+void FTD_Structure::PublishView() {
+  std::lock_guard<std::mutex> lock(view_mtx_);
+  if (!view_) view_ = std::make_shared<FTD_Gallery>();
+  if (view_.use_count() > 1) {
+    if (!spare_view_ || spare_view_.use_count() > 1)
+      spare_view_ = std::make_shared<FTD_Gallery>();
+    std::swap(view_, spare_view_);
+  }
+  view_->Sync(gallery_);
+}
+
+void FTD_Structure::SetQueries(int ndet) {
+  // detections become the gallery queries, in the gallery storage type
+  int dim = gallery_.dim();
+  gallery_.ResizeQueries(ndet);
+  for (int j = 0; j < ndet; ++j) {
+    CHECK(detections_[j]->feat_dim == dim)
+        << "error feature dim " << detections_[j]->feat_dim << " vs. " << dim;
+    gallery_.SetQuery(j, detections_[j]->feat);
+  }
+}
+
+void FTD_Structure::Geometry(int begin, int end,
+                             std::vector<int>& candidates, bool shared) {
+  int ndet = detections_.size();
+  for (int j = begin; j < end; ++j) {
+    auto rect_i = detections_[j]->bbox;
+    auto label_i = detections_[j]->label;
+    candidates.clear();
+    if (shared)
+      grid_.QueryShared(rect_i, candidates);
+    else
+      grid_.Query(rect_i, candidates);
+    for (int i : candidates) {
+      auto rect_t = std::get<1>(tracks[i]->GetCharact());
+      auto label_t = std::get<3>(tracks[i]->GetCharact());
+      if (label_t != label_i) continue;
+      iou_mat_[i * ndet + j] = 1.0f - GetIou(rect_t, rect_i);
+      center_mat_[i * ndet + j] = GetCenterDis(rect_i, rect_t);
+    }
+  }
+}
+
+void FTD_Structure::FeatRows(int begin, int end, int ndet) {
+  for (int i = begin; i < end; ++i) {
+    const float* dot_row = &dot_buf_[tracks[i]->GetSlot() * ndet];
+    double* row = &feat_mat_[i * ndet];
+    for (int j = 0; j < ndet; ++j) {
+      double cdis = FeatUnitDistance(dot_row[j]);
+      row[j] = cdis < 2.0 ? cdis : 2.0;
+    }
+  }
+}
+
+void FTD_Structure::PreparedDistances(const FTD_Prepared& prepared,
+                                      int ntrack, int ndet) {
+  const auto& view = prepared.gallery;
+  bool has_dot = !prepared.dot.empty();
+  int stale = 0;
+  for (int i = 0; i < ntrack; ++i) {
+    int slot = tracks[i]->GetSlot();
+    double* row = &feat_mat_[i * ndet];
+    if (has_dot && slot < view.rows() &&
+        view.Version(slot) == gallery_.Version(slot)) {
+      const float* dot_row = &prepared.dot[slot * ndet];
+      for (int j = 0; j < ndet; ++j) {
+        double cdis = FeatUnitDistance(dot_row[j]);
+        row[j] = cdis < 2.0 ? cdis : 2.0;
+      }
+      continue;
+    }
+    // changed after the view was taken, or new since
+    if (stale++ == 0) SetQueries(ndet);
+    for (int j = 0; j < ndet; ++j) {
+      double cdis = gallery_.QueryDistance(slot, j);
+      row[j] = cdis < 2.0 ? cdis : 2.0;
+    }
+  }
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER))
+      << "prepared: " << ntrack - stale << " tracks, " << stale << " stale";
+}
+
+bool FTD_Structure::Accept(const cv::Rect_<float>& rect, float score) const {
+  // rect = rect & roi_range;
+  return rect.width > 0.f && rect.height > 0.f && score >= score_threshold;
+}
+
+void FTD_Structure::MakeDetections(std::vector<InputCharact>& input_characts,
+                                   std::vector<DetectCharact>& detections) {
+  detections.clear();
+  for (auto ici = input_characts.begin(); ici != input_characts.end();) {
+    if (!Accept(std::get<1>(*ici), std::get<2>(*ici))) {
+      ici = input_characts.erase(ici);
+      continue;
+    }
+    auto& feat = std::get<0>(*ici);
+    CHECK(feat.isContinuous()) << "feature must be continuous";
+    detections.push_back({feat.ptr<float>(0), feat.cols, std::get<1>(*ici),
+                          std::get<2>(*ici), std::get<3>(*ici),
+                          std::get<4>(*ici)});
+    ici++;
+  }
+}
+
+void FTD_Structure::Update(uint64_t frame_id, bool detect_flag, int mode,
+                           const DetectCharact* detections, size_t count,
+                           std::vector<OutputCharact>& output_characts,
+                           DetectResult* detect_results,
+                           const FTD_Prepared* prepared) {
   __TIC__(update);
   remove_id_this_frame.clear();
+  frame_id_ = frame_id;
   frame_count += 1;
   LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "frame " << frame_id << " detect_flag " << detect_flag;
   // get range of frame and check detect_flag
-  std::vector<OutputCharact> output_characts;
+  output_characts.clear();
   if (detect_flag == false)
-    CHECK(input_characts.size() == 0) << "error input_characts size";
+    CHECK(count == 0) << "error input_characts size";
     // roi_range = cv::Rect_<float>(0.f, 0.f, 1.f, 1.f);
 // show and prune predict
   LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "there are already " << tracks.size()
             << " trajectory(id predict_bbox):";
-  for (auto ti = tracks.begin(); ti != tracks.end();) {
-    (*ti)->Predict();
-    auto track_rect = std::get<1>((*ti)->GetCharact());
-    if (track_rect.width <= 0.f || track_rect.height <= 0.f) {
-      auto track_id = (*ti)->GetId();
+  // every box is predicted in one pass over the motion models, the few
+  // clocks that wrap this frame are rebased by their filter first
+  if (use_kalman_) {
+    kalman_.Predict();
+  } else {
+    models_.Step(wrapped_);
+    for (int i : wrapped_) tracks[i]->Wrap();
+    models_.Predict();
+  }
+  const auto& bad = use_kalman_ ? kalman_.bad : models_.bad;
+  for (size_t i = 0; i < tracks.size();) {
+    auto ti = tracks[i];
+    auto track_rect = use_kalman_ ? kalman_.Box(i) : models_.Box(i);
+    if (bad[i]) {
+      auto track_id = ti->GetId();
       LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "trajectory " << track_id << " predict fail, remove "
                 << track_id;
-      ti = tracks.erase(ti);
+      // the last track and its prediction move here and are checked next
+      RemoveTrack(i);
     } else {
-      auto track_id = (*ti)->GetId();
+      ti->Predict(track_rect);
+      auto track_id = ti->GetId();
       LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << track_id << " " << track_rect;
-      ti++;
+      i++;
     }
   }
   if (detect_flag == false) {
-    for (auto ti : tracks) ti->UpdateWithoutDetect();
-    GetOut(output_characts);
-    return output_characts;
+    for (auto& ti : tracks) ti->UpdateWithoutDetect();
+    GetOut(output_characts, detect_results);
+    AutoSnapshot();
+    if (publish_) PublishView();
+    return;
   }
 // show detect
-  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "there are " << input_characts.size()
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "there are " << count
             << " new detections(bbox):";
   LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "size: " << tracks.size();
-  for (auto ici = input_characts.begin(); ici != input_characts.end();) {
-    auto rect = std::get<1>(*ici);
-    auto ici_score = std::get<2>(*ici);
-    // rect = rect & roi_range;
-    if (rect.width <= 0.f || rect.height <= 0.f ||
-        ici_score < score_threshold) {
-      ici = input_characts.erase(ici);
-    } else {
-      std::get<1>(*ici) = rect;
-      LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << rect;
-      ici++;
-    }
+  detections_.clear();
+  // every detection is rejected until GetOut finds its track
+  for (size_t k = 0; detect_results && k < count; ++k)
+    detect_results[k] = {0u, detections[k].bbox, DetectResult::REJECTED};
+  for (size_t k = 0; k < count; ++k) {
+    if (!Accept(detections[k].bbox, detections[k].score)) continue;
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << detections[k].bbox;
+    detections_.push_back(&detections[k]);
   }
-  vector<Mat> feats;
-  for (auto& ic : input_characts) {
-    feats.emplace_back(get<0>(ic));
-  }
-  __TIC__(get_dis);
-  // double dismat[features.size()][feats.size()];
-  vector<vector<double>> feat_dists(tracks.size(),
-                                    vector<double>(feats.size(), 0));
-  ;
-  for (size_t i = 0; i < tracks.size(); ++i) {
-    for (size_t j = 0; j < feats.size(); ++j) {
-      double min_dis = 2.0;
-      //for (size_t h = 0; h < tracks[i]->GetFeatures().size(); ++h) {
-      for (size_t h = 0; h < 1u; ++h) {
-        double cdis = get_euro_dis(tracks[i]->GetFeatures()[h], feats[j]);
-        // double cdis = cosine_distance(tracks[i]->GetFeatures()[h], feats[j]);
-        min_dis = cdis < min_dis ? cdis : min_dis;
-      }
-      feat_dists[i][j] = min_dis;
-    }
-  }
-  __TOC__(get_dis);
+  int ntrack = tracks.size();
+  int ndet = detections_.size();
+  // the dense association takes what it can from the prepared frame and
+  // converts the queries itself only if some track is stale
+  if (prepared && (gate_ > 0 || cascade_ > 0)) prepared = nullptr;
+  if (ntrack > 0 && ndet > 0 && !prepared) SetQueries(ndet);
 
-  __TIC__(deal);
-  /*cal iou between predict and det*/
-  vector<vector<double>> neg_iou_scores;
-  vector<vector<double>> center_dists;
-  for (auto& t : tracks) {
-    std::vector<double> neg_iou_score;
-    std::vector<double> center_dis;
-    for (auto& ic : input_characts) {
-      auto rect_t = std::get<1>(t->GetCharact());
-      auto label_t = std::get<3>(t->GetCharact());
-      auto rect_i = std::get<1>(ic);
-      auto label_i = std::get<3>(ic);
-      neg_iou_score.push_back(
-          label_t == label_i ? (1.0f - GetIou(rect_t, rect_i)) : 1.0f);
-      center_dis.push_back(label_t == label_i ? GetCenterDis(rect_i, rect_t)
-                                              : 0.0f);
-    }
-    neg_iou_scores.emplace_back(neg_iou_score);
-    center_dists.emplace_back(center_dis);
-  }
-  // CHECK SIZE for all matrix
-  int divide1 = tracks.size();
-  int divide2 = input_characts.size();
-  CHECK((int)neg_iou_scores.size() == divide1) << "iou_score size error";
-  CHECK((int)feat_dists.size() == divide1) << "feat_dis size error";
-
-  FtdHungarian HungAlgo;
-  vector<int> assignment;
-  HungAlgo.Solve(neg_iou_scores, assignment);
-  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "assign size: " << assignment.size();
-  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "iou: ";
-  for (unsigned int x = 0; x < assignment.size(); x++)
-    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << assignment[x];
-  // greedy find match track and detect number
-  std::vector<int> match_track;
-  std::vector<int> match_detect;
-  for (size_t iii = 0; iii < assignment.size(); iii++) {
-    if (assignment[iii] == -1) continue;
-    if (((1.0f - neg_iou_scores[iii][assignment[iii]]) >= iou_threshold) &&
-        (feat_dists[iii][assignment[iii]] < feat_distance_low - 0.1) &&
-        assignment[iii] != -1) {
-      match_track.push_back(iii);
-      match_detect.push_back(assignment[iii]);
-      for (int i = 0; i < divide1; i++) {
-        feat_dists[i][match_detect.back()] = feat_distance_high + 1.0f;
-      }
-      for (int i = 0; i < divide2; i++) {
-        feat_dists[match_track.back()][i] = feat_distance_high + 1.0f;
-      }
-    }
-    if ((1.0f - neg_iou_scores[iii][assignment[iii]] >= iou_threshold) &&
-        (feat_dists[iii][assignment[iii]] > feat_distance_high)) {
-      feat_dists[iii][assignment[iii]] = feat_distance_high + 1.0f;
+  // all per-frame lists are members, they keep their capacity across frames
+  match_track_.clear();
+  match_detect_.clear();
+  if (gate_ > 0) {
+    __TIC__(gated_assign);
+    AssociateGated(match_track_, match_detect_);
+    __TOC__(gated_assign);
+  } else {
+    // split by rows over the workers in crowded frames
+    int parts = 1;
+    if (workers_ && ntrack * ndet >= parallel_pairs_)
+      parts = workers_->size();
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER) && parts > 1)
+        << ntrack << " x " << ndet << " matrices in " << parts << " parts";
+    __TIC__(deal);
+    /*cal iou between predict and det*/
+    // only pairs sharing grid cells can overlap, all others keep iou 0 and
+    // a center outside the track
+    iou_mat_.assign(ntrack * ndet, 1.0);
+    center_mat_.assign(ntrack * ndet, 0.0);
+    grid_boxes_.clear();
+    for (auto& t : tracks) grid_boxes_.push_back(std::get<1>(t->GetCharact()));
+    grid_.Build(grid_boxes_);
+    if (parts > 1) {
+      __TIC__(deal_parallel);
+      workers_->Run(parts, [&](int p) {
+        Geometry(ndet * p / parts, ndet * (p + 1) / parts,
+                 part_candidates_[p], true);
+      });
+      __TOC__(deal_parallel);
+    } else {
+      Geometry(0, ndet, candidates_, false);
     }
-  }
-  CHECK(match_track.size() == match_detect.size())
-      << "match_track and match_detect must have the same size";
+    __TOC__(deal);
 
-  // find unmatch_track and unmatch_detect number by order
-  vector<int> unmatch_track;
-  FindRemain(match_track, unmatch_track, divide1);
-  vector<int> unmatch_detect;
-  FindRemain(match_detect, unmatch_detect, divide2);
-  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "unmatchdet1 size: " << unmatch_detect.size();
-
-  vector<int> feats_assign;
-  HungAlgo.Solve(feat_dists, feats_assign);
-  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "feats: ";
-  for (unsigned int x = 0; x < feats_assign.size(); x++)
-    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << feats_assign[x];
-  for (size_t iii = 0; iii < feats_assign.size(); iii++) {
-    if (feats_assign[iii] == -1) continue;
-    if (feat_dists[iii][feats_assign[iii]] < feat_distance_low) {
-      match_track.push_back(iii);
-      match_detect.push_back(feats_assign[iii]);
-      for (int i = 0; i < divide1; i++) {
-        feat_dists[i][match_detect.back()] = feat_distance_high + 1.0f;
-      }
-      for (int i = 0; i < divide2; i++) {
-        feat_dists[match_track.back()][i] = feat_distance_high + 1.0f;
+    __TIC__(get_dis);
+    if (cascade_ > 0) {
+      AssociateCascade(ntrack, ndet, match_track_, match_detect_);
+    } else {
+      feat_mat_.assign(ntrack * ndet, 0.0);
+      if (ntrack > 0 && ndet > 0 && prepared) {
+        PreparedDistances(*prepared, ntrack, ndet);
+      } else if (ntrack > 0 && ndet > 0) {
+        dot_buf_.resize(gallery_.rows() * ndet);
+        // one pass over the whole gallery, rows of free slots are ignored
+        // below; the gallery keeps unit rows, so a dot product is a distance
+        if (parts > 1) {
+          __TIC__(feat_parallel);
+          int rows = gallery_.rows();
+          workers_->Run(parts, [&](int p) {
+            gallery_.QueryDotMatrix(dot_buf_.data(), ndet, rows * p / parts,
+                                    rows * (p + 1) / parts);
+          });
+          workers_->Run(parts, [&](int p) {
+            FeatRows(ntrack * p / parts, ntrack * (p + 1) / parts, ndet);
+          });
+          __TOC__(feat_parallel);
+        } else {
+          gallery_.QueryDotMatrix(dot_buf_.data(), ndet);
+          FeatRows(0, ntrack, ndet);
+        }
       }
+      MaskLabels(ntrack, ndet, nullptr, nullptr, feat_mat_.data());
+      Associate(ntrack, ndet, iou_mat_.data(), feat_mat_.data(),
+                center_mat_.data(), match_track_, match_detect_);
     }
+    __TOC__(get_dis);
   }
+  CHECK(match_track_.size() == match_detect_.size())
+      << "match_track and match_detect must have the same size";
 
-  if (!unmatch_track.empty() && !unmatch_detect.empty()) {
-    for (size_t i = 0; i < feat_dists.size(); ++i) {
-      for (size_t j = 0; j < feat_dists[i].size(); ++j) {
-        if (!center_dists[i][j]) feat_dists[i][j] = feat_distance_high + 1.0f;
-      }
-    }
-    feats_assign.clear();
-    HungAlgo.Solve(feat_dists, feats_assign);
-    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "feats2: ";
-    for (unsigned int x = 0; x < feats_assign.size(); x++)
-      LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << x << " " << feats_assign[x];
-    for (size_t iii = 0; iii < feats_assign.size(); iii++) {
-      if (feats_assign[iii] == -1) continue;
-      if (feat_dists[iii][feats_assign[iii]] < feat_distance_high) {
-        match_track.push_back(iii);
-        match_detect.push_back(feats_assign[iii]);
-      }
-    }
-    // find unmatch_track and unmatch_detect number by order
-    unmatch_track.clear();
-    FindRemain(match_track, unmatch_track, divide1);
-    unmatch_detect.clear();
-    FindRemain(match_detect, unmatch_detect, divide2);
-    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "untrack size: " << unmatch_track.size();
-    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "unmatchdet2 size: " << unmatch_detect.size();
+  // find unmatch_detect number by order
+  unmatch_detect_.clear();
+  detect_matched_.assign(ndet, 0);
+  for (auto d : match_detect_) detect_matched_[d] = 1;
+  for (int j = 0; j < ndet; ++j) {
+    if (!detect_matched_[j]) unmatch_detect_.push_back(j);
   }
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "untrack size: " << ntrack - match_track_.size();
+  LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "unmatchdet size: " << unmatch_detect_.size();
 
   /*new detection with new id*/
-  for (unsigned int i = 0; i < unmatch_detect.size(); i++) {
+  for (auto d : unmatch_detect_) {
     // reid for new detection here
-    tracks.push_back(std::make_shared<FTD_Trajectory>(specified_cfg_));
-    tracks.back()->Init(input_characts[unmatch_detect[i]], id_record, mode);
-    tracks.back()->UpdateFeature(feats[unmatch_detect[i]]);
+    tracks.push_back(pool_.Acquire(specified_cfg_, &gallery_));
+    int row = tracks.size() - 1;
+    ResizeMotion(row + 1);
+    if (use_kalman_)
+      kalman_.Init(row, detections_[d]->bbox);
+    else
+      tracks.back()->Bind(&models_, row);
+    tracks.back()->Init(*detections_[d], id_record, mode);
+    tracks.back()->detect_index = detections_[d] - detections;
+    events_.Push(TrackEvent::CREATED, frame_id, 0u, detections_[d]->local_id);
+    tracks.back()->UpdateFeature(detections_[d]->feat, detections_[d]->feat_dim);
   }
 
   /*strategy for match_track detect and unmatch detect*/
-  for (unsigned int i = 0; i < match_track.size(); i++) {
-    tracks[match_track[i]]->UpdateDetect(input_characts[match_detect[i]]);
-    tracks[match_track[i]]->UpdateFeature(feats[match_detect[i]]);
+  for (unsigned int i = 0; i < match_track_.size(); i++) {
+    auto& detect = *detections_[match_detect_[i]];
+    auto ti = tracks[match_track_[i]];
+    if (ti->lost) {
+      events_.Push(TrackEvent::REIDENTIFIED, frame_id, ti->GetId(),
+                   detect.local_id);
+      ti->lost = false;
+    }
+    ti->UpdateDetect(detect);
+    ti->detect_index = &detect - detections;
+    ti->UpdateFeature(detect.feat, detect.feat_dim);
   }
-  GetOut(output_characts);
-  __TOC__(deal);
+  // confirmed tracks left without a detection
+  for (auto ti : tracks) {
+    if (ti->time_since_update > 0 && !ti->lost && ti->GetId() != 0) {
+      events_.Push(TrackEvent::LOST, frame_id, ti->GetId(), -1);
+      ti->lost = true;
+    }
+  }
+  if (use_kalman_) {
+    // one batch for all matched tracks, the corrected box is reported
+    kalman_boxes_.clear();
+    for (auto d : match_detect_)
+      kalman_boxes_.push_back(detections_[d]->bbox);
+    kalman_.Update(match_track_.data(), kalman_boxes_.data(),
+                   match_track_.size());
+    for (auto t : match_track_)
+      get<1>(tracks[t]->GetCharact()) = kalman_.Box(t);
+  }
+  GetOut(output_characts, detect_results);
+  AutoSnapshot();
+  if (publish_) PublishView();
   __TOC__(update);
-  return output_characts;
 }
 
 std::vector<int> FTD_Structure::GetRemoveID() { return remove_id_this_frame; }
 
+size_t FTD_Structure::PopEvents(TrackEvent* events, size_t max_count,
+                                uint64_t* dropped) {
+  if (dropped) *dropped = events_.dropped();
+  return events_.Pop(events, max_count);
+}
+
 }  // namespace ai
 }  // namespace vitis
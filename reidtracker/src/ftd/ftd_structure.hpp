@@ -17,13 +17,19 @@
 #ifndef _FTD_STRUCTURE_HPP
 #define _FTD_STRUCTURE_HPP
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
 #include <vitis/ai/reid.hpp>
+#include "ftd_event_ring.hpp"
+#include "ftd_grid.hpp"
 #include "ftd_hungarian.hpp"
+#include "ftd_lap.hpp"
+#include "ftd_track_pool.hpp"
 #include "ftd_trajectory.hpp"
+#include "ftd_workers.hpp"
 typedef pair<int, Mat> imagePair;
 class paircomp {
  public:
@@ -36,6 +42,18 @@ class paircomp {
 namespace vitis {
 namespace ai {
 
+// Appearance of the detections of one frame against a view of the track
+// features, computed by FTD_Structure::Prepare without the track lock.
+struct FTD_Prepared {
+  uint64_t frame_id = 0;
+  // the accepted detections, borrowing the features of the input
+  std::vector<DetectCharact> detections;
+  // the view the dot products were computed on
+  FTD_Gallery gallery;
+  // gallery.rows() x detections.size(), empty without a view
+  std::vector<float> dot;
+};
+
 class FTD_Structure {
  public:
   FTD_Structure(const SpecifiedCfg& specified_cfg);
@@ -45,7 +63,47 @@ class FTD_Structure {
   std::vector<OutputCharact> Update(uint64_t frame_id, bool detect_flag,
                                     int mode,
                                     std::vector<InputCharact>& input_characts);
+  // Same as above, output_characts is cleared and refilled so its capacity
+  // is reused; does not allocate once the track count is stable.
+  // If prepared is not null and was made by Prepare for the same
+  // input_characts, its distances are used for the tracks whose features
+  // did not change since, only the others are computed.
+  void Update(uint64_t frame_id, bool detect_flag, int mode,
+              std::vector<InputCharact>& input_characts,
+              std::vector<OutputCharact>& output_characts,
+              const FTD_Prepared* prepared = nullptr);
+  // Core of the above on a read-only span of detection records, rejected
+  // detections are skipped instead of erased. If detect_results is not
+  // null it receives count results, one per detection in input order.
+  void Update(uint64_t frame_id, bool detect_flag, int mode,
+              const DetectCharact* detections, size_t count,
+              std::vector<OutputCharact>& output_characts,
+              DetectResult* detect_results = nullptr,
+              const FTD_Prepared* prepared = nullptr);
+  // The part of Update that needs no lock: rejects detections as
+  // MakeDetections does and computes their dot products against the view of
+  // the track features published by the last Update. May run on any thread,
+  // concurrently with Update and other Prepare calls.
+  std::unique_ptr<FTD_Prepared> Prepare(
+      uint64_t frame_id, std::vector<InputCharact>& input_characts);
+  // Returns a prepared frame for reuse by the next Prepare.
+  void Recycle(std::unique_ptr<FTD_Prepared> prepared);
+  // Erases the detections Update rejects, as the tuple API always did, and
+  // fills detections with records borrowing the remaining features.
+  void MakeDetections(std::vector<InputCharact>& input_characts,
+                      std::vector<DetectCharact>& detections);
+  // gids of the confirmed tracks removed by the last Update
   std::vector<int> GetRemoveID();
+  // drains the lifecycle events, may run on another thread than Update
+  size_t PopEvents(TrackEvent* events, size_t max_count, uint64_t* dropped);
+  // Versioned binary image of the tracks, their filters and features and
+  // the id counters. Restore replaces the current state, or leaves the
+  // structure empty and returns false for a damaged or foreign image.
+  void Save(std::vector<char>& image) const;
+  bool Restore(const char* data, size_t size);
+  // Saves an image every period frames at the end of Update, written to
+  // path by a background thread; period 0 stops.
+  void SetSnapshot(const std::string& path, int period);
 
   int max_age = 60;
   int min_hits = 3;
@@ -59,11 +117,124 @@ class FTD_Structure {
   float feat_distance_high;
   float score_threshold;
   cv::Rect_<float> roi_range;
-  std::vector<std::shared_ptr<FTD_Trajectory>> tracks;
+  // declared before the pool: trajectories release their slot on destruction
+  FTD_Gallery gallery_;
+  FTD_TrackPool pool_;
+  // live trajectories, unordered: removal swaps the last one into the hole
+  std::vector<FTD_Trajectory*> tracks;
+  // motion models of the tracks, row i belongs to tracks[i]; the Kalman
+  // models replace the linear ones when the cfg selects them
+  bool use_kalman_;
+  FTD_LinearModels models_;
+  std::vector<int> wrapped_;
+  FTD_KalmanModels kalman_;
+  std::vector<cv::Rect_<float>> kalman_boxes_;
 
-  void GetOut(std::vector<OutputCharact>& output_characts);
+  // storage format of gallery_ from the environment
+  void ConfigureGallery();
+  void RemoveTrack(size_t index);
+  // releases every track without events
+  void DropTracks();
+  void AutoSnapshot();
+  // copies the changed track features to the view read by Prepare
+  void PublishView();
+  void SetQueries(int ndet);
+  // feat_mat_ from the prepared dot products, stale tracks are recomputed
+  void PreparedDistances(const FTD_Prepared& prepared, int ntrack, int ndet);
+  // iou_mat_ and center_mat_ entries of detections [begin, end); shared
+  // queries the grid without writing it, for concurrent calls
+  void Geometry(int begin, int end, std::vector<int>& candidates, bool shared);
+  // feat_mat_ rows of tracks [begin, end) from dot_buf_
+  void FeatRows(int begin, int end, int ndet);
+  void ResizeMotion(int rows);
+  void GetOut(std::vector<OutputCharact>& output_characts,
+              DetectResult* detect_results);
+  // Three-pass matching (iou, appearance, center gated appearance) on a
+  // dense ntrack x ndet block; feat is modified, matches are appended.
+  void Associate(int ntrack, int ndet, const double* neg_iou, double* feat,
+                 const double* center, std::vector<int>& match_track,
+                 std::vector<int>& match_detect);
+  // Sets the appearance distance of pairs of different labels to the
+  // largest one, so that no pass matches them; rows and columns are tracks
+  // and detections_, or the ones listed in track_index and detect_index.
+  void MaskLabels(int ntrack, int ndet, const int* track_index,
+                  const int* detect_index, double* feat);
+  // Commits the confident iou pairs of iou_mat_ on geometry alone, then
+  // runs Associate on the rest with appearance computed for it only; the
+  // matrices are overwritten. See REID_TRACKER_CASCADE.
+  void AssociateCascade(int ntrack, int ndet, std::vector<int>& match_track,
+                        std::vector<int>& match_detect);
+  bool Accept(const cv::Rect_<float>& rect, float score) const;
+  void AssociateGated(std::vector<int>& match_track,
+                      std::vector<int>& match_detect);
   std::vector<int> remove_id_this_frame;
+  // lifecycle events, and the frame the events of an Update belong to
+  FTD_EventRing events_;
+  uint64_t frame_id_;
+  // periodic snapshot, the image buffer is reused
+  std::unique_ptr<FTD_SnapshotFile> snapshot_;
+  int snapshot_period_;
+  std::vector<char> snapshot_image_;
+  // view of the gallery for Prepare, published once Prepare is used; a view
+  // is never written while a Prepare holds it, the spare takes over then.
+  // References are taken and dropped under view_mtx_.
+  std::atomic<bool> publish_;
+  std::mutex view_mtx_;
+  std::shared_ptr<FTD_Gallery> view_;
+  std::shared_ptr<FTD_Gallery> spare_view_;
+  std::mutex prepared_mtx_;
+  std::vector<std::unique_ptr<FTD_Prepared>> prepared_pool_;
+  // accepted detections of the frame, and the records of the tuple API
+  std::vector<const DetectCharact*> detections_;
+  std::vector<DetectCharact> detect_buf_;
   SpecifiedCfg specified_cfg_;
+  // scratch for the batched feature distance, kept across frames
+  std::vector<float> dot_buf_;
+  // assignment solver, its workspace is reused by every Update
+  FtdLapSolver lap_;
+  std::vector<int> assignment_;
+  std::vector<double> feat_mat_;
+  std::vector<double> iou_mat_;
+  std::vector<double> center_mat_;
+  std::vector<char> detect_matched_;
+  std::vector<int> match_track_;
+  std::vector<int> match_detect_;
+  std::vector<int> unmatch_detect_;
+  // spatial index over predicted (or gate) boxes, rebuilt each frame
+  FTD_Grid grid_;
+  std::vector<cv::Rect_<float>> grid_boxes_;
+  std::vector<int> candidates_;
+
+  // parts of the dense matrices built in parallel from
+  // REID_TRACKER_PARALLEL_PAIRS pairs on, on the process wide workers
+  int parallel_pairs_;
+  FTD_Workers* workers_;
+  std::vector<std::vector<int>> part_candidates_;
+
+  // cascade association, see REID_TRACKER_CASCADE
+  int cascade_;
+  std::vector<int> track_hits_;
+  std::vector<int> detect_hits_;
+  std::vector<int> rest_track_;
+  std::vector<int> rest_detect_;
+
+  // gated association, see REID_TRACKER_GATE
+  struct Edge {
+    int track;
+    int det;
+    double neg_iou;
+    double center;
+    double feat;
+  };
+  int gate_;
+  std::vector<Edge> edges_;
+  std::vector<int> parent_;
+  std::vector<int> comp_node_start_;
+  std::vector<int> comp_edge_start_;
+  std::vector<int> comp_fill_;
+  std::vector<int> comp_nodes_;
+  std::vector<int> comp_edges_;
+  std::vector<int> local_index_;
 };
 
 }  // namespace ai
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_track_pool.hpp"
+
+namespace vitis {
+namespace ai {
+
+FTD_Trajectory *FTD_TrackPool::Acquire(SpecifiedCfg &specified_cfg,
+                                       FTD_Gallery *gallery) {
+  if (!free_.empty()) {
+    FTD_Trajectory *track = free_.back();
+    free_.pop_back();
+    return track;
+  }
+  slab_.emplace_back(specified_cfg, gallery);
+  // Release never has to grow the free list
+  if (free_.capacity() < slab_.size()) free_.reserve(2 * slab_.size());
+  return &slab_.back();
+}
+
+void FTD_TrackPool::Release(FTD_Trajectory *track) {
+  track->Release();
+  free_.push_back(track);
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FTD_TRACK_POOL_HPP_
+#define _FTD_TRACK_POOL_HPP_
+
+#include <deque>
+#include <vector>
+#include "ftd_trajectory.hpp"
+
+namespace vitis {
+namespace ai {
+
+/// Slab of trajectory objects owned by one FTD_Structure.
+///
+/// Trajectories are constructed once and recycled through a free list, so
+/// creating a track costs no allocation once the pool has grown to the peak
+/// number of live tracks. The storage is a deque, which never moves existing
+/// elements, so the returned pointers stay valid until the pool is destroyed.
+class FTD_TrackPool {
+ public:
+  FTD_TrackPool(){};
+  ~FTD_TrackPool(){};
+  FTD_TrackPool(const FTD_TrackPool &) = delete;
+  FTD_TrackPool &operator=(const FTD_TrackPool &) = delete;
+
+  /// Returns an unused trajectory, Init must be called before use.
+  FTD_Trajectory *Acquire(SpecifiedCfg &specified_cfg, FTD_Gallery *gallery);
+  /// Gives the trajectory and its gallery slot back to the pool.
+  void Release(FTD_Trajectory *track);
+  /// Number of trajectory objects constructed so far.
+  int capacity() const { return slab_.size(); }
+
+ private:
+  std::deque<FTD_Trajectory> slab_;
+  std::vector<FTD_Trajectory *> free_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
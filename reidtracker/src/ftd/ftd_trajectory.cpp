@@ -16,26 +16,44 @@
 
 #include "ftd_trajectory.hpp"
 #include <glog/logging.h>
+#include <cmath>
 #include <iostream>
 
 using namespace std;
 namespace vitis {
 namespace ai {
 
-FTD_Trajectory::FTD_Trajectory(SpecifiedCfg& specified_cfg) {
+FTD_Trajectory::FTD_Trajectory(SpecifiedCfg& specified_cfg,
+                               FTD_Gallery* gallery)
+    : gallery_(gallery), slot_(-1), has_feature_(false) {
   this->B2G = std::get<1>(specified_cfg)[0];
   this->G2B = std::get<1>(specified_cfg)[1];
   this->B2D = std::get<1>(specified_cfg)[2];
   specified_cfg_ = specified_cfg;
+  linear_ = !FTD_KalmanModels::Selected(specified_cfg);
 }
 
-void FTD_Trajectory::Predict() {
+FTD_Trajectory::~FTD_Trajectory() { Release(); }
+
+void FTD_Trajectory::Release() {
+  if (slot_ >= 0) gallery_->Free(slot_);
+  slot_ = -1;
+}
+
+void FTD_Trajectory::Predict(const cv::Rect_<float>& bbox) {
   age += 1;
   if (time_since_update > 0) hit_streak = 0;
   time_since_update += 1;
-  std::get<1>(charact) = filter.GetPre();
+  detect_index = -1;
+  std::get<1>(charact) = bbox;
+}
+
+void FTD_Trajectory::Bind(FTD_LinearModels* models, int row) {
+  filter.Bind(models, row);
 }
 
+void FTD_Trajectory::Wrap() { filter.Wrap(); }
+
 int FTD_Trajectory::GetId() { return id; }
 
 void  FTD_Trajectory::SetId(uint64_t &update_id){
@@ -44,7 +62,7 @@ void  FTD_Trajectory::SetId(uint64_t &update_id){
 
 InputCharact& FTD_Trajectory::GetCharact() { return charact; }
 
-void FTD_Trajectory::Init(const InputCharact& input_charact,
+void FTD_Trajectory::Init(const DetectCharact& detect,
                           std::vector<uint64_t>& id_record, int mode) {
   // Init id and charact
   CHECK(!id_record.empty()) << "id_record must not be empty";
@@ -56,12 +74,20 @@ void FTD_Trajectory::Init(const InputCharact& input_charact,
     id_record.erase(id_record.begin());
   }
   // std::cout<<"new id: "<<id<<endl;
-  charact = input_charact;
+  charact = InputCharact(cv::Mat(), detect.bbox, detect.score, detect.label,
+                         detect.local_id);
+  if (slot_ < 0) slot_ = gallery_->Alloc();
+  has_feature_ = false;
+  hit_streak = 0;
+  age = 0;
+  time_since_update = 0;
+  detect_index = -1;
+  lost = false;
   LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Init a new trajectory(id " << id << ", bbox "
             << std::get<1>(charact) << ", label " << std::get<3>(charact)
             << ")";
   // Init FTD_ReidTracker and FTD_Filter
-  filter.Init(std::get<1>(charact), mode, specified_cfg_);
+  if (linear_) filter.Init(std::get<1>(charact), mode, specified_cfg_);
   // Init others
   status = 0;
   leap = 1;
@@ -73,18 +99,19 @@ void FTD_Trajectory::Init(const InputCharact& input_charact,
   }
 }
 
-void FTD_Trajectory::UpdateDetect(const InputCharact& input_charact) {
+void FTD_Trajectory::UpdateDetect(const DetectCharact& detect) {
   // Update charact
-  CHECK(std::get<3>(charact) == std::get<3>(input_charact))
+  CHECK(std::get<3>(charact) == detect.label)
       << "UpdateDetect must have the same label";
-  charact = input_charact;
+  charact = InputCharact(cv::Mat(), detect.bbox, detect.score, detect.label,
+                         detect.local_id);
   LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "trajectory " << id << " update_detector with bbox "
             << std::get<1>(charact);
   time_since_update = 0;
   age += 1;
   hit_streak += 1;
   // Init FTD_ReidTracker and Update FTD_Filter
-  filter.UpdateDetect(std::get<1>(charact));
+  if (linear_) filter.UpdateDetect(std::get<1>(charact));
   // Update life
   if (status == 1) {
     leap = 0;
@@ -119,16 +146,71 @@ void FTD_Trajectory::UpdateTrack() {
   }
 }
 
-void FTD_Trajectory::UpdateFeature(const cv::Mat& feat) {
-  if (feature.size() == cv::Size(0, 0))
-    feature = feat;
-  else
-    feature = feature * 0.9 + feat * 0.1;
-  if (features.size() > 1) features.pop_back();
-  features.emplace_back(feature);
+void FTD_Trajectory::UpdateFeature(const float* feat, int dim) {
+  if (!has_feature_) {
+    gallery_->Init(slot_, feat, dim);
+    has_feature_ = true;
+  } else {
+    gallery_->Blend(slot_, feat, 0.1f);
+    gallery_->AddExemplar(slot_, feat);
+  }
+}
+
+void FTD_Trajectory::Save(FTD_SnapshotOut& out) const {
+  out.Put(id);
+  out.Put(std::get<1>(charact));
+  out.Put(std::get<2>(charact));
+  out.Put(std::get<3>(charact));
+  out.Put(std::get<4>(charact));
+  out.Put(hit_streak);
+  out.Put(age);
+  out.Put(time_since_update);
+  out.Put(lost);
+  out.Put(status);
+  out.Put(leap);
+  out.Put(have_been_shown);
+  out.Put(has_feature_);
+  if (has_feature_) gallery_->SaveSlot(out, slot_);
+  if (linear_) filter.Save(out);
 }
 
-std::vector<cv::Mat> FTD_Trajectory::GetFeatures() { return features; }
+bool FTD_Trajectory::Load(FTD_SnapshotIn& in) {
+  cv::Rect_<float> bbox;
+  float score = 0.f;
+  int label = 0, local_id = -1;
+  in.Get(id);
+  in.Get(bbox);
+  in.Get(score);
+  in.Get(label);
+  in.Get(local_id);
+  in.Get(hit_streak);
+  in.Get(age);
+  in.Get(time_since_update);
+  in.GetBool(lost);
+  in.Get(status);
+  in.Get(leap);
+  in.GetBool(have_been_shown);
+  in.GetBool(has_feature_);
+  if (!in.ok()) return false;
+  // counters only grow from 0 with age, status is one of the three states
+  bool ok = std::isfinite(bbox.x) && std::isfinite(bbox.y) &&
+            std::isfinite(bbox.width) && std::isfinite(bbox.height) &&
+            std::isfinite(score) && age >= 0 && hit_streak >= 0 &&
+            hit_streak <= age && time_since_update >= 0 &&
+            time_since_update <= age && status >= -1 && status <= 1;
+  if (!ok) {
+    in.Fail();
+    return false;
+  }
+  charact = InputCharact(cv::Mat(), bbox, score, label, local_id);
+  detect_index = -1;
+  if (slot_ < 0) slot_ = gallery_->Alloc();
+  if (has_feature_ && !gallery_->LoadSlot(in, slot_)) return false;
+  return !linear_ || filter.Load(in);
+}
+
+int FTD_Trajectory::GetSlot() { return slot_; }
+
 void FTD_Trajectory::UpdateWithoutDetect() {
   // update FTD_ReidTracker and Update FTD_Filter
   filter.UpdateFilter();
@@ -140,8 +222,9 @@ int FTD_Trajectory::GetStatus() { return status; }
 bool FTD_Trajectory::GetShown() { return have_been_shown; }
 
 OutputCharact FTD_Trajectory::GetOut() {
-  return std::make_tuple(id, filter.GetPost(), std::get<2>(charact),
-                         std::get<3>(charact), std::get<4>(charact));
+  auto bbox = linear_ ? filter.GetPost() : std::get<1>(charact);
+  return std::make_tuple(id, bbox, std::get<2>(charact), std::get<3>(charact),
+                         std::get<4>(charact));
 }
 
 }  // namespace ai
@@ -19,7 +19,10 @@
 
 #include <tuple>
 #include <vitis/ai/env_config.hpp>
+#include "../../include/vitis/ai/reidtracker.hpp"
+#include "ftd_filter_kalman.hpp"
 #include "ftd_filter_linear.hpp"
+#include "ftd_gallery.hpp"
 DEF_ENV_PARAM(DEBUG_REID_TRACKER, "0")
 
 
@@ -32,25 +35,48 @@ namespace ai {
 typedef std::tuple<cv::Mat, cv::Rect_<float>, float, int, int> InputCharact;
 // OutputCharact: gid, roi, score, label, local_id
 typedef std::tuple<uint64_t, cv::Rect_<float>, float, int, int> OutputCharact;
+// DetectCharact: feat, feat_dim, roi, score, label, local_id; the feature is
+// borrowed from the caller
+typedef ReidTracker::Detection DetectCharact;
+typedef ReidTracker::DetectionResult DetectResult;
+typedef ReidTracker::TrackEvent TrackEvent;
 
 class FTD_Trajectory {
  public:
-  FTD_Trajectory(SpecifiedCfg& specified_cfg);
-  ~FTD_Trajectory(){};
-  void Predict();
+  FTD_Trajectory(SpecifiedCfg& specified_cfg, FTD_Gallery* gallery);
+  ~FTD_Trajectory();
+  FTD_Trajectory(const FTD_Trajectory&) = delete;
+  FTD_Trajectory& operator=(const FTD_Trajectory&) = delete;
+  // Advances the life counters and takes the box predicted for this frame,
+  // see FTD_LinearModels.
+  void Predict(const cv::Rect_<float>& bbox);
+  // Places the motion state in a row of models, before Init and whenever
+  // the track moves in the owner's list. Only for the linear model, the
+  // owner runs FTD_KalmanModels itself and sets the box through charact.
+  void Bind(FTD_LinearModels* models, int row);
+  // Rebases the motion model when its clock wraps.
+  void Wrap();
   int GetId();
   void  SetId(uint64_t &update_id);
   InputCharact& GetCharact();
-  void Init(const InputCharact& input_charact, std::vector<uint64_t>& id_record,
+  // Starts a new track, takes a gallery slot; a released trajectory can be
+  // initialized again.
+  void Init(const DetectCharact& detect, std::vector<uint64_t>& id_record,
             int mode);
+  // Frees the gallery slot, the trajectory is unused until the next Init.
+  void Release();
+  // Snapshot of the whole track: counters, motion filter (linear model
+  // only, see Bind) and features. Load replaces Init for a restored track.
+  void Save(FTD_SnapshotOut& out) const;
+  bool Load(FTD_SnapshotIn& in);
   void UpdateTrack();
-  void UpdateDetect(const InputCharact& input_charact);
+  void UpdateDetect(const DetectCharact& detect);
   void UpdateWithoutDetect();
-  void UpdateFeature(const cv::Mat& feat);
+  void UpdateFeature(const float* feat, int dim);
   int GetStatus();
   bool GetShown();
   OutputCharact GetOut();
-  std::vector<cv::Mat> GetFeatures();
+  int GetSlot();
   int B2G;
   int G2B;
   int B2D;
@@ -58,17 +84,25 @@ class FTD_Trajectory {
   int hit_streak = 0;
   int age = 0;
   int time_since_update = 0;
+  // index of the detection assigned in the current frame, -1 if none
+  int detect_index = -1;
+  // confirmed and missed detection frames since its last match
+  bool lost = false;
 
  private:
   int id;
+  // the feature is not kept, charact holds an empty Mat
   InputCharact charact;
   // FTD_Filter filter;
   // FTD_Filter_Light filter;
   FTD_Filter_Linear filter;
   // FTD_Filter_Run filter;
+  // false when the owner tracks the motion with FTD_KalmanModels
+  bool linear_;
   SpecifiedCfg specified_cfg_;
-  std::vector<cv::Mat> features;
-  cv::Mat feature;
+  FTD_Gallery* gallery_;
+  int slot_;
+  bool has_feature_;
   int status;
   bool have_been_shown;
 };
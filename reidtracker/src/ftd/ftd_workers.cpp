@@ -0,0 +1,76 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ftd_workers.hpp"
+
+namespace vitis {
+namespace ai {
+
+FTD_Workers::FTD_Workers(int threads)
+    : fn_(nullptr), parts_(0), next_(0), remaining_(0), stop_(false) {
+  for (int t = 0; t < threads; ++t)
+    threads_.emplace_back(&FTD_Workers::Loop, this);
+}
+
+FTD_Workers::~FTD_Workers() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto &t : threads_) t.join();
+}
+
+void FTD_Workers::Run(int parts, const std::function<void(int)> &fn) {
+  std::unique_lock<std::mutex> run(run_mtx_, std::try_to_lock);
+  if (parts <= 1 || threads_.empty() || !run.owns_lock()) {
+    for (int p = 0; p < parts; ++p) fn(p);
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mtx_);
+  fn_ = &fn;
+  parts_ = parts;
+  next_ = 0;
+  remaining_ = parts;
+  work_cv_.notify_all();
+  Work(lock);
+  done_cv_.wait(lock, [this] { return remaining_ == 0; });
+  // a late worker finds no part left and never reads fn_ again
+  fn_ = nullptr;
+}
+
+void FTD_Workers::Work(std::unique_lock<std::mutex> &lock) {
+  while (next_ < parts_) {
+    int part = next_++;
+    auto fn = fn_;
+    lock.unlock();
+    (*fn)(part);
+    lock.lock();
+    if (--remaining_ == 0) done_cv_.notify_all();
+  }
+}
+
+void FTD_Workers::Loop() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    work_cv_.wait(lock, [this] { return stop_ || next_ < parts_; });
+    if (stop_) return;
+    Work(lock);
+  }
+}
+
+}  // namespace ai
+}  // namespace vitis
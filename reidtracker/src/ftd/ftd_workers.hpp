@@ -0,0 +1,67 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FTD_WORKERS_HPP_
+#define _FTD_WORKERS_HPP_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vitis {
+namespace ai {
+
+/// Small persistent pool for splitting one stage of a frame into parts.
+///
+/// Run hands the parts to the workers and takes its share on the calling
+/// thread, returning once every part is done. The pool serves one Run at a
+/// time; a Run finding it busy (another tracker in the process) does all of
+/// its parts on the caller instead of waiting.
+class FTD_Workers {
+ public:
+  explicit FTD_Workers(int threads);
+  FTD_Workers(const FTD_Workers &) = delete;
+  FTD_Workers &operator=(const FTD_Workers &) = delete;
+  ~FTD_Workers();
+
+  /// Threads taking part in a Run, the caller included.
+  int size() const { return threads_.size() + 1; }
+  /// Calls fn(part) for every part in [0, parts).
+  void Run(int parts, const std::function<void(int)> &fn);
+
+ private:
+  void Loop();
+  // runs parts until none is left, with mtx_ held on entry and exit
+  void Work(std::unique_lock<std::mutex> &lock);
+
+  std::vector<std::thread> threads_;
+  // one Run at a time
+  std::mutex run_mtx_;
+  std::mutex mtx_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int)> *fn_;
+  int parts_;
+  int next_;
+  int remaining_;
+  bool stop_;
+};
+
+}  // namespace ai
+}  // namespace vitis
+#endif
@@ -15,86 +15,103 @@
  */
 
 #pragma once
-#include <condition_variable>
-#include <mutex>
-#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
 
 namespace vitis {
 namespace ai {
 
+/// Lock-free ring of values keyed by frame id.
+///
+/// The value of frame id lives in slot id % capacity, so lookup is O(1).
+/// Every slot carries a tag, the id it holds or one of the states below,
+/// which validates a lookup and arbitrates the slot: a writer or a reader
+/// first moves the tag to a busy state with a compare and swap, so a value
+/// is never read while it is overwritten. A newer id overwrites the slot of
+/// an older one, the ring keeps the most recent capacity frames. Pushes may
+/// come from several threads as long as no two push the same slot at once,
+/// which holds for increasing ids.
 template <typename T>
 class RingQueue {
  public:
   explicit RingQueue(std::size_t capacity)
-      : capacity_(capacity),
-        buffer_(capacity),
-        size_(0U),
-        front_(0U),
-        rear_(0U) {}
+      : capacity_(capacity > 0 ? capacity : 1),
+        slots_(new Slot[capacity_]) {}
 
   std::size_t capacity() const { return capacity_; }
-  std::size_t size() const { return size_; }
 
-  void push(const T &new_value) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    buffer_[rear_] = new_value;
-    rear_ = (rear_ + 1) % capacity_;
-    if (size_ >= capacity_) {
-      front_ = rear_;
-    } else {
-      ++size_;
-    }
+  /// Stores value as the result of id, replacing what its slot held.
+  void push(uint64_t id, T &&value) {
+    auto &slot = slots_[id % capacity_];
+    Acquire(slot);
+    slot.value = std::move(value);
+    slot.tag.store(Tag(id), std::memory_order_release);
   }
 
-  bool pop(T &value) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    bool res = false;
-    if (size_ > 0) {
-      value = buffer_[front_];
-      front_ = (front_ + 1) % capacity_;
-      --size_;
-      res = true;
-    }
-    return res;
+  /// Moves the value of id out of the ring, false if it is not there
+  /// (never pushed, taken already or overwritten).
+  bool take(uint64_t id, T &value) {
+    auto &slot = slots_[id % capacity_];
+    uint64_t tag = Tag(id);
+    if (!slot.tag.compare_exchange_strong(tag, kBusy,
+                                          std::memory_order_acquire))
+      return false;
+    value = std::move(slot.value);
+    slot.value = T();
+    slot.tag.store(kEmpty, std::memory_order_release);
+    return true;
   }
 
-  T *pop() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    T *res = nullptr;
-    if (size_ > 0) {
-      res = &buffer_[front_];
-      front_ = (front_ + 1) % capacity_;
-      --size_;
+  /// Takes every value, calling f(id, value) in slot order.
+  template <typename F>
+  void drain(F f) {
+    for (std::size_t k = 0; k < capacity_; ++k) {
+      auto &slot = slots_[k];
+      uint64_t tag = slot.tag.load(std::memory_order_relaxed);
+      if (tag < kFirstId) continue;
+      T value;
+      if (take(tag - kFirstId, value)) f(tag - kFirstId, value);
     }
-    return res;
   }
 
-  T *front() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    T *res = nullptr;
-    if (size_ > 0) {
-      res = &buffer_[front_];
+  void clear() {
+    for (std::size_t k = 0; k < capacity_; ++k) {
+      auto &slot = slots_[k];
+      Acquire(slot);
+      slot.value = T();
+      slot.tag.store(kEmpty, std::memory_order_release);
     }
-    return res;
   }
 
-  bool clear() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (size_ > 0) {
-      front_ = rear_ = 0;
-      size_ = 0;
+ private:
+  // tags below kFirstId are states, the others are ids offset by kFirstId
+  static const uint64_t kEmpty = 0;
+  static const uint64_t kBusy = 1;
+  static const uint64_t kFirstId = 2;
+  struct Slot {
+    std::atomic<uint64_t> tag{kEmpty};
+    T value;
+  };
+  static uint64_t Tag(uint64_t id) { return id + kFirstId; }
+  // waits out a concurrent reader of the slot, then owns it
+  static void Acquire(Slot &slot) {
+    uint64_t tag = slot.tag.load(std::memory_order_relaxed);
+    for (;;) {
+      if (tag == kBusy) {
+        std::this_thread::yield();
+        tag = slot.tag.load(std::memory_order_relaxed);
+      } else if (slot.tag.compare_exchange_weak(tag, kBusy,
+                                                std::memory_order_acquire)) {
+        return;
+      }
     }
-    return true;
   }
 
- private:
   std::size_t capacity_;
-  std::vector<T> buffer_;
-  std::size_t size_;
-  std::size_t front_;
-  std::size_t rear_;
-
-  mutable std::mutex mtx_;
+  std::unique_ptr<Slot[]> slots_;
 };
 
 }  // namespace ai
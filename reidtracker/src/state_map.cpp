@@ -21,54 +21,119 @@
 namespace vitis {
 namespace ai {
 
-StateMap::StateMap()
-    : m_data_(new map<int, State>),
+StateMap::StateMap(int window)
+    : window_(std::max(window, 1)),
+      ids_(window_, -1),
+      states_(window_, INIT),
+      low_id_(-1),
+      high_id_(-1),
       cur_id_(-1),
       last_tracked_id_(-1),
-      cur_state_(State(0)) {}
+      cur_state_(State(0)),
+      bad_mask_(0u),
+      waiters_(window_, nullptr),
+      wait_stats_{0, 0, 0, 0.0, 0.0} {}
 
-StateMap::~StateMap() { delete m_data_; }
+StateMap::~StateMap() {}
 
-StateMap::State StateMap::get(int id) { return m_data_->at(id); }
+StateMap::State StateMap::get(int id) {
+  std::lock_guard<std::mutex> lock(this->mtx_);
+  CHECK(id >= 0 && present(id)) << "no state for id " << id;
+  return states_[id % window_];
+}
 
 int StateMap::getCurId() {
   std::lock_guard<std::mutex> lock(this->mtx_);
   return cur_id_;
 }
 
+bool StateMap::waitCur(int id, std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(this->mtx_);
+  bool acquired = cur_id_ == id;
+  if (!acquired && id >= 0) {
+    auto start = std::chrono::steady_clock::now();
+    // the waiter lives on this stack, linked in the slot of its id
+    Waiter self;
+    self.id = id;
+    self.next = waiters_[id % window_];
+    waiters_[id % window_] = &self;
+    acquired = self.cv.wait_until(lock, start + timeout,
+                                  [this, id] { return cur_id_ == id; });
+    for (Waiter** w = &waiters_[id % window_]; *w; w = &(*w)->next) {
+      if (*w == &self) {
+        *w = self.next;
+        break;
+      }
+    }
+    double wait = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    wait_stats_.contended++;
+    wait_stats_.wait_sum += wait;
+    wait_stats_.wait_max = std::max(wait_stats_.wait_max, wait);
+  }
+  if (acquired) {
+    wait_stats_.acquired++;
+  } else {
+    wait_stats_.timeouts++;
+  }
+  return acquired;
+}
+
+StateMap::WaitStats StateMap::getWaitStats() {
+  std::lock_guard<std::mutex> lock(this->mtx_);
+  return wait_stats_;
+}
+
 StateMap::State StateMap::getCurState() {
   std::lock_guard<std::mutex> lock(this->mtx_);
   return cur_state_;
 }
 
+void StateMap::moveCur(int id) {
+  bool changed = id != cur_id_;
+  cur_id_ = id;
+  cur_state_ = id >= 0 ? states_[id % window_] : State(0);
+  if (!changed || id < 0) return;
+  DLOG(INFO) << "updateCur: " << id;
+  // hand the lock to the waiters of the new current id only
+  for (Waiter* w = waiters_[id % window_]; w; w = w->next) {
+    if (w->id == id) w->cv.notify_one();
+  }
+}
+
 void StateMap::updateCur() {
   DLOG(INFO) << "try updateCur";
-  auto it = m_data_->begin();
-  while (it != m_data_->end() &&
-         std::find(bad_states_.begin(), bad_states_.end(), it->second) !=
-             bad_states_.end()) {
-    it++;
-  }
-  if (it != m_data_->end()) {
-    DLOG(INFO) << "updateCur: " << it->first;
-    cur_id_ = it->first;
-    cur_state_ = it->second;
-  } else {
-    cur_id_ = -1;
-    cur_state_ = State(0);
+  int id = low_id_;
+  while (id >= 0 && id <= high_id_ &&
+         !(present(id) && !bad(states_[id % window_]))) {
+    id++;
   }
+  moveCur(id >= 0 && id <= high_id_ ? id : -1);
 }
 
 bool StateMap::set(int id, State new_state) {
   std::lock_guard<std::mutex> lock(this->mtx_);
   DLOG(INFO) << "try set: " << id << " state: " << new_state;
-  bool success = false;
-  if (m_data_->find(id) != m_data_->end()) {
-    m_data_->at(id) = new_state;
-    updateCur();
-    success = true;
+  if (id < 0 || !present(id)) return false;
+  states_[id % window_] = new_state;
+  // the current id is the lowest good one: only a change at or below it
+  // moves it
+  if (id == cur_id_) {
+    if (bad(new_state)) {
+      int next = id + 1;
+      while (next <= high_id_ &&
+             !(present(next) && !bad(states_[next % window_]))) {
+        next++;
+      }
+      moveCur(next <= high_id_ ? next : -1);
+    } else {
+      cur_state_ = new_state;
+    }
+  } else if (!bad(new_state) && (cur_id_ < 0 || id < cur_id_)) {
+    moveCur(id);
   }
-  return success;
+  return true;
 }
 
 bool StateMap::updateLastTrackedId(int id) {
@@ -90,7 +155,8 @@ int StateMap::getLastTrackedId() {
 
 void StateMap::addBadState(State bad_state) {
   std::lock_guard<std::mutex> lock(this->mtx_);
-  bad_states_.emplace_back(bad_state);
+  bad_mask_ |= 1u << bad_state;
+  updateCur();
 }
 
 bool StateMap::add(int id, State new_state) {
@@ -101,53 +167,70 @@ bool StateMap::add(int id, State new_state) {
                   << id << " vs last_tracked_id: " << last_tracked_id_;
     return false;
   }
-  bool success = false;
-  if (m_data_->find(id) != m_data_->end()) {
+  if (id < 0) {
+    DLOG(WARNING) << "id must not be negative: " << id;
+    return false;
+  }
+  int slot = id % window_;
+  if (ids_[slot] == id) {
     DLOG(WARNING) << "fail to add new id to exist id: " << id;
-  } else {
-    (*m_data_)[id] = new_state;
-    updateCur();
-    success = true;
+    return false;
+  }
+  if (ids_[slot] != -1) {
+    LOG(WARNING) << "state window of " << window_ << " frames is full, id "
+                 << id << " needs the slot of id " << ids_[slot];
+    return false;
   }
-  return success;
+  ids_[slot] = id;
+  states_[slot] = new_state;
+  if (low_id_ < 0 || id < low_id_) low_id_ = id;
+  if (id > high_id_) high_id_ = id;
+  if (!bad(new_state) && (cur_id_ < 0 || id < cur_id_)) moveCur(id);
+  return true;
 }
 
 void StateMap::clearState(State target_state) {
   DLOG(INFO) << "in clearState  state: " << target_state;
-  for (auto it = m_data_->begin(); it != m_data_->end();) {
-    if (it->second == target_state) {
-      m_data_->erase(it++);
-    } else {
-      it++;
+  int low = -1, high = -1;
+  for (int id = low_id_; id >= 0 && id <= high_id_; ++id) {
+    if (!present(id)) continue;
+    if (states_[id % window_] == target_state) {
+      ids_[id % window_] = -1;
+      continue;
     }
+    if (low < 0) low = id;
+    high = id;
   }
+  low_id_ = low;
+  high_id_ = high;
   last_tracked_id_ = -1;
-  cur_id_ = -1;
-  cur_state_ = State(0);
+  // find the current id again and wake its waiter
+  updateCur();
 }
 
 void StateMap::clearAll() {
-  m_data_->clear();
-
-  cur_id_ = -1;
+  std::lock_guard<std::mutex> lock(this->mtx_);
+  std::fill(ids_.begin(), ids_.end(), -1);
+  low_id_ = high_id_ = -1;
+  moveCur(-1);
   last_tracked_id_ = -1;
-  cur_state_ = State(0);
 }
 
 void StateMap::clearBadStates() {
   std::lock_guard<std::mutex> lock(this->mtx_);
   // DLOG(INFO) << "try clearBadState";
-  for (auto bad_state : bad_states_) {
+  for (int state = INIT; state <= TRC_ED; ++state) {
     // DLOG(INFO) << "try clearBadStates: " << bad_state;
-    clearState(bad_state);
+    if (bad(State(state))) clearState(State(state));
   }
 }
 
 void StateMap::print() {
   std::lock_guard<std::mutex> lock(this->mtx_);
   LOG(INFO) << std::string(50, '+');
-  for (auto it : *m_data_) {
-    LOG(INFO) << "StateMap[" << it.first << "]= " << it.second;
+  for (int id = low_id_; id >= 0 && id <= high_id_; ++id) {
+    if (present(id))
+      LOG(INFO) << "StateMap[" << id << "]= " << states_[id % window_];
   }
   LOG(INFO) << "cur_id_ = " << cur_id_;
   LOG(INFO) << std::string(50, '-');
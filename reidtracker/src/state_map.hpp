@@ -15,16 +15,24 @@
  */
 
 #pragma once
-#include <map>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <vector>
 
-using std::map;
 using std::vector;
 
 namespace vitis {
 namespace ai {
 
+/// States of the frames in flight in MODE_MULTIDETS mode.
+///
+/// Frames live in a circular window indexed by frame id % window, so the
+/// window must be larger than the span of frame ids in flight; adding an
+/// id whose slot still holds another frame fails. The current id, the
+/// lowest frame whose state is not bad, is kept up to date on every
+/// transition instead of being searched for.
 class StateMap {
  public:
   enum State {
@@ -35,8 +43,16 @@ class StateMap {
     TRC_ST = 4,
     TRC_ED = 5
   };
+  /// Contention of waitCur, wait times in microseconds.
+  struct WaitStats {
+    uint64_t acquired;
+    uint64_t contended;
+    uint64_t timeouts;
+    double wait_sum;
+    double wait_max;
+  };
 
-  StateMap();
+  explicit StateMap(int window = 1024);
   ~StateMap();
 
   bool add(int id, State new_state);
@@ -46,6 +62,10 @@ class StateMap {
 
   State get(int id);
   int getCurId();
+  /// Blocks until id is the current id, false on timeout. Each waiter is
+  /// woken only when the current id becomes its own.
+  bool waitCur(int id, std::chrono::milliseconds timeout);
+  WaitStats getWaitStats();
   State getCurState();
 
   void clearState(State target_state);
@@ -60,15 +80,34 @@ class StateMap {
   int getLastTrackedId();
 
  private:
+  struct Waiter {
+    int id;
+    std::condition_variable cv;
+    Waiter *next;
+  };
+  bool present(int id) const { return ids_[id % window_] == id; }
+  bool bad(State state) const { return bad_mask_ >> state & 1u; }
+  // moves the current id to id (-1: none) and wakes its waiters
+  void moveCur(int id);
+  // finds the current id again, from the lowest frame on
   void updateCur();
 
-  map<int, State> *m_data_;
+  int window_;
+  // frame id held by each slot (-1: empty) and its state
+  vector<int> ids_;
+  vector<State> states_;
+  // bounds of the frame ids held, -1 when empty
+  int low_id_;
+  int high_id_;
 
   int cur_id_;
   int last_tracked_id_;
   State cur_state_;
-  vector<State> bad_states_;
+  unsigned bad_mask_;
   mutable std::mutex mtx_;
+  // threads in waitCur, listed in the slot of the id they wait for
+  vector<Waiter *> waiters_;
+  WaitStats wait_stats_;
 };
 
 }  // namespace ai
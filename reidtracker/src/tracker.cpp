@@ -16,6 +16,7 @@
 
 #include "../include/vitis/ai/reidtracker.hpp"
 #include "tracker_imp.hpp"
+#include "tracker_manager.hpp"
 
 namespace vitis {
 namespace ai {
@@ -28,5 +29,14 @@ std::shared_ptr<ReidTracker> ReidTracker::create(uint64_t mode,
   return std::shared_ptr<ReidTracker>(new ReidTrackerImp(mode, cfg));
 }
 
+ReidTrackerManager::ReidTrackerManager() {}
+ReidTrackerManager::~ReidTrackerManager() {}
+
+std::shared_ptr<ReidTrackerManager> ReidTrackerManager::create(
+    int workers, uint64_t mode, const ReidTracker::SpecifiedCfg &cfg) {
+  return std::shared_ptr<ReidTrackerManager>(
+      new ReidTrackerManagerImp(workers, mode, cfg));
+}
+
 }  // namespace ai
 }  // namespace vitis
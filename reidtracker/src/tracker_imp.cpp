@@ -19,6 +19,12 @@
 #include "ftd/ftd_structure.hpp"
 #include "state_map.hpp"
 
+// Number of most recent undetected frames whose tracks are kept for
+// outputUndetTracks in MODE_MULTIDETS mode.
+DEF_ENV_PARAM(REID_TRACKER_UNDET_FRAMES, "100")
+// Span of frame ids in flight the MODE_MULTIDETS state window can hold.
+DEF_ENV_PARAM(REID_TRACKER_STATE_WINDOW, "1024")
+
 namespace vitis {
 namespace ai {
 
@@ -26,12 +32,14 @@ ReidTrackerImp::ReidTrackerImp(uint64_t mode, const SpecifiedCfg& cfg) {
   mode_ = mode;
   ftd_ = new FTD_Structure(cfg);
   if (mode & MODE_MULTIDETS) {
-    sm_ = new StateMap();
+    sm_ = new StateMap(ENV_PARAM(REID_TRACKER_STATE_WINDOW));
     sm_->addBadState(StateMap::DET_TO);
     sm_->addBadState(StateMap::TRC_ED);
 
-    undet_tracks_ =
-        new RingQueue<std::pair<uint64_t, std::vector<OutputCharact>>>(100);
+    undet_tracks_ = new RingQueue<std::vector<OutputCharact>>(
+        std::max(ENV_PARAM(REID_TRACKER_UNDET_FRAMES), 1));
+    prepared_ = new RingQueue<std::unique_ptr<FTD_Prepared>>(
+        std::max(ENV_PARAM(REID_TRACKER_STATE_WINDOW), 1));
   }
 }
 
@@ -40,15 +48,22 @@ ReidTrackerImp::~ReidTrackerImp() {
   if (mode_ & MODE_MULTIDETS) {
     delete sm_;
     delete undet_tracks_;
+    delete prepared_;
   }
 }
 
 std::vector<int> ReidTrackerImp::GetRemoveID() { return ftd_->GetRemoveID(); }
 
+size_t ReidTrackerImp::PopEvents(TrackEvent* events, size_t max_count,
+                                 uint64_t* dropped) {
+  return ftd_->PopEvents(events, max_count, dropped);
+}
+
 void ReidTrackerImp::clear() {
   ftd_->clear();
   if (mode_ & MODE_MULTIDETS) {
     undet_tracks_->clear();
+    prepared_->clear();
     sm_->clearAll();
     sm_->addBadState(StateMap::DET_TO);
     sm_->addBadState(StateMap::TRC_ED);
@@ -57,6 +72,20 @@ void ReidTrackerImp::clear() {
   }
 }
 
+void ReidTrackerImp::setSnapshot(const std::string& path, int period) {
+  ftd_->SetSnapshot(path, period);
+}
+
+bool ReidTrackerImp::restoreSnapshot(const std::string& path) {
+  clear();
+  FTD_MappedFile file(path);
+  if (!file.data()) {
+    LOG(WARNING) << "fail to map snapshot " << path;
+    return false;
+  }
+  return ftd_->Restore(file.data(), file.size());
+}
+
 std::vector<OutputCharact> ReidTrackerImp::patchFrame(const uint64_t frame_id) {
   std::vector<InputCharact> empty_charact;
   std::vector<OutputCharact> det_track;
@@ -73,6 +102,21 @@ std::vector<OutputCharact> ReidTrackerImp::track(
   if (mode_ & MODE_MULTIDETS) {
     return det_track;
   }
+  ftd_->MakeDetections(input_characts, detections_);
+  track(frame_id, detections_.data(), detections_.size(), is_detection,
+        is_normalized, det_track);
+  return det_track;
+}
+
+void ReidTrackerImp::track(const uint64_t frame_id,
+                           const Detection* detections, size_t count,
+                           const bool is_detection, const bool is_normalized,
+                           std::vector<OutputCharact>& output_characts,
+                           DetectionResult* detection_results) {
+  output_characts.clear();
+  if (mode_ & MODE_MULTIDETS) {
+    return;
+  }
 
   if (lastframe_id && (frame_id > lastframe_id + 1) &&
       (mode_ & MODE_AUTOPATCH)) {
@@ -81,11 +125,10 @@ std::vector<OutputCharact> ReidTrackerImp::track(
       patchFrame(lastframe_id + i);
     }
   }
-  det_track =
-      ftd_->Update(frame_id, is_detection, is_normalized, input_characts);
+  ftd_->Update(frame_id, is_detection, is_normalized, detections, count,
+               output_characts, detection_results);
 
   lastframe_id = frame_id;
-  return det_track;
 }
 
 bool ReidTrackerImp::addDetStart(int frame_id) {
@@ -111,15 +154,11 @@ bool ReidTrackerImp::setDetTimeout(int frame_id) {
 
 bool ReidTrackerImp::setTrackLock(int frame_id, int timeout, int interval) {
   if (mode_ & MODE_MULTIDETS) {
-    int time = 0;
-    while (sm_->getCurId() != frame_id) {
-      LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: wait for mutex, fid: " << frame_id
-                 << " cur_id: " << sm_->getCurId();
-      std::this_thread::sleep_for(std::chrono::milliseconds(interval));
-      if ((time += interval) > timeout) {
-        LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: setTrackLock timeout.";
-        return false;
-      }
+    LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: wait for mutex, fid: " << frame_id
+               << " cur_id: " << sm_->getCurId();
+    if (!sm_->waitCur(frame_id, std::chrono::milliseconds(timeout))) {
+      LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: setTrackLock timeout.";
+      return false;
     }
     LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: start track, fid: " << frame_id;
     sm_->updateLastTrackedId(frame_id);
@@ -128,6 +167,19 @@ bool ReidTrackerImp::setTrackLock(int frame_id, int timeout, int interval) {
   return false;
 }
 
+ReidTracker::TrackLockStats ReidTrackerImp::getTrackLockStats() {
+  TrackLockStats stats{0, 0, 0, 0.0, 0.0};
+  if (mode_ & MODE_MULTIDETS) {
+    auto wait = sm_->getWaitStats();
+    stats.acquired = wait.acquired;
+    stats.contended = wait.contended;
+    stats.timeouts = wait.timeouts;
+    if (wait.contended) stats.wait_avg = wait.wait_sum / wait.contended;
+    stats.wait_max = wait.wait_max;
+  }
+  return stats;
+}
+
 bool ReidTrackerImp::releaseTrackLock(int frame_id) {
   if (mode_ & MODE_MULTIDETS) {
     LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "Track: end track, fid: " << frame_id;
@@ -140,6 +192,15 @@ bool ReidTrackerImp::releaseTrackLock(int frame_id) {
   return false;
 }
 
+bool ReidTrackerImp::prepareTrack(const uint64_t frame_id,
+                                  std::vector<InputCharact>& input_characts) {
+  if (mode_ & MODE_MULTIDETS) {
+    prepared_->push(frame_id, ftd_->Prepare(frame_id, input_characts));
+    return true;
+  }
+  return false;
+}
+
 std::vector<OutputCharact> ReidTrackerImp::trackWithoutLock(
     const uint64_t frame_id, std::vector<InputCharact>& input_characts,
     const bool is_detection, const bool is_normalized) {
@@ -153,12 +214,16 @@ std::vector<OutputCharact> ReidTrackerImp::trackWithoutLock(
             ftd_->Update(last_tracked_id, false, is_normalized, empty_charact);
         LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "do undet_track for " << last_tracked_id
                    << " frame_id: " << frame_id;
-        undet_tracks_->push(
-            std::make_pair<uint64_t, std::vector<OutputCharact>>(
-                last_tracked_id, std::move(undet_track)));
+        undet_tracks_->push(last_tracked_id, std::move(undet_track));
       }
     }
-    return ftd_->Update(frame_id, is_detection, is_normalized, input_characts);
+    std::vector<OutputCharact> det_track;
+    std::unique_ptr<FTD_Prepared> prepared;
+    prepared_->take(frame_id, prepared);
+    ftd_->Update(frame_id, is_detection, is_normalized, input_characts,
+                 det_track, prepared.get());
+    if (prepared) ftd_->Recycle(std::move(prepared));
+    return det_track;
   }
   return std::vector<OutputCharact>();
 };
@@ -179,13 +244,9 @@ std::vector<OutputCharact> ReidTrackerImp::trackWithLock(
 std::vector<OutputCharact> ReidTrackerImp::outputUndetTracks(
     uint64_t frame_id) {
   if (mode_ & MODE_MULTIDETS) {
-    if (undet_tracks_->size() != 0) {
-      while (undet_tracks_->front()->first <= frame_id) {
-        auto result = undet_tracks_->pop();
-        if (result->first == frame_id) {
-          return result->second;
-        }
-      }
+    std::vector<OutputCharact> result;
+    if (undet_tracks_->take(frame_id, result)) {
+      return result;
     }
     DLOG(WARNING) << "no results found for frame_id: " << frame_id;
   }
@@ -194,14 +255,13 @@ std::vector<OutputCharact> ReidTrackerImp::outputUndetTracks(
 
 void ReidTrackerImp::printUndetTracks() {
   if (mode_ & MODE_MULTIDETS) {
-    if (undet_tracks_->size() != 0) {
-      while (undet_tracks_->front()) {
-        auto result = undet_tracks_->pop();
-        LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "UndetTracks: " << result->first;
-      }
-      return;
-    }
-    DLOG(WARNING) << "no results found";
+    bool found = false;
+    undet_tracks_->drain(
+        [&](uint64_t id, const std::vector<OutputCharact>& tracks) {
+          LOG_IF(INFO, ENV_PARAM(DEBUG_REID_TRACKER)) << "UndetTracks: " << id;
+          found = true;
+        });
+    if (!found) DLOG(WARNING) << "no results found";
   }
   return;
 };
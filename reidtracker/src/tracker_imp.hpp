@@ -44,11 +44,17 @@ class ReidTrackerImp : public ReidTracker {
    */
   virtual std::vector<int> GetRemoveID() override;
 
+  virtual size_t PopEvents(TrackEvent* events, size_t max_count,
+                           uint64_t* dropped = nullptr) override;
+
   /**
    * @brief Function to clear the state of ReidTracker.
    */
   virtual void clear() override;
 
+  virtual void setSnapshot(const std::string& path, int period) override;
+  virtual bool restoreSnapshot(const std::string& path) override;
+
   /**
    * @brief Function to patch the missing frame.
    *
@@ -61,6 +67,11 @@ class ReidTrackerImp : public ReidTracker {
   virtual std::vector<OutputCharact> track(
       const uint64_t frame_id, std::vector<InputCharact>& input_characts,
       const bool is_detection, const bool is_normalized) override;
+  virtual void track(const uint64_t frame_id, const Detection* detections,
+                     size_t count, const bool is_detection,
+                     const bool is_normalized,
+                     std::vector<OutputCharact>& output_characts,
+                     DetectionResult* detection_results = nullptr) override;
 
   virtual bool addDetStart(int frame_id) override;
   virtual bool setDetEnd(int frame_id) override;
@@ -68,6 +79,10 @@ class ReidTrackerImp : public ReidTracker {
   virtual bool setTrackLock(int frame_id, int timeout = 1000,
                             int interval = 1) override;
   virtual bool releaseTrackLock(int frame_id) override;
+  virtual TrackLockStats getTrackLockStats() override;
+  virtual bool prepareTrack(
+      const uint64_t frame_id,
+      std::vector<InputCharact>& input_characts) override;
   virtual std::vector<OutputCharact> trackWithoutLock(
       const uint64_t frame_id, std::vector<InputCharact>& input_characts,
       const bool is_detection = true, const bool is_normalized = true) override;
@@ -84,8 +99,12 @@ class ReidTrackerImp : public ReidTracker {
   StateMap* sm_ = NULL;
   uint64_t mode_ = 0;
   uint64_t lastframe_id = 0;
-  RingQueue<std::pair<uint64_t, std::vector<OutputCharact>>>* undet_tracks_ =
-      NULL;
+  // records of the tuple based track, reused across frames
+  std::vector<Detection> detections_;
+  // tracks of the auto patched frames, by frame id
+  RingQueue<std::vector<OutputCharact>>* undet_tracks_ = NULL;
+  // frames prepared by prepareTrack, by frame id
+  RingQueue<std::unique_ptr<FTD_Prepared>>* prepared_ = NULL;
 };
 
 }  // namespace ai
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracker_manager.hpp"
+#include <algorithm>
+
+namespace vitis {
+namespace ai {
+
+ReidTrackerManagerImp::ReidTrackerManagerImp(
+    int workers, uint64_t mode, const ReidTracker::SpecifiedCfg& cfg)
+    : mode_(mode), cfg_(cfg) {
+  CHECK(!(mode & ReidTracker::MODE_MULTIDETS))
+      << "ReidTrackerManager does not support MODE_MULTIDETS";
+  if (workers <= 0) workers = std::thread::hardware_concurrency();
+  workers = std::max(workers, 1);
+  for (int i = 0; i < workers; ++i) {
+    workers_.emplace_back(&ReidTrackerManagerImp::Run, this);
+  }
+}
+
+ReidTrackerManagerImp::~ReidTrackerManagerImp() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) worker.join();
+}
+
+std::shared_ptr<ReidTrackerManagerImp::Stream>&
+ReidTrackerManagerImp::GetStream(int stream_id) {
+  auto& stream = streams_[stream_id];
+  if (!stream) {
+    stream = std::make_shared<Stream>();
+    stream->tracker = ReidTracker::create(mode_, cfg_);
+  }
+  return stream;
+}
+
+std::shared_ptr<ReidTracker> ReidTrackerManagerImp::tracker(int stream_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return GetStream(stream_id)->tracker;
+}
+
+bool ReidTrackerManagerImp::removeStream(int stream_id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return streams_.erase(stream_id) > 0;
+}
+
+std::future<uint64_t> ReidTrackerManagerImp::track(
+    int stream_id, const ReidTracker::Detection* detections, size_t count,
+    const bool is_detection, const bool is_normalized,
+    std::vector<ReidTracker::OutputCharact>& output_characts,
+    ReidTracker::DetectionResult* detection_results) {
+  std::future<uint64_t> future;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& stream = GetStream(stream_id);
+    stream->jobs.push_back(Job{++stream->frame_id, detections, count,
+                               is_detection, is_normalized, &output_characts,
+                               detection_results, Clock::now(),
+                               std::promise<uint64_t>()});
+    future = stream->jobs.back().done.get_future();
+    if (stream->scheduled) return future;
+    stream->scheduled = true;
+    ready_.push_back(stream);
+  }
+  cv_.notify_one();
+  return future;
+}
+
+ReidTrackerManager::StreamStats ReidTrackerManagerImp::stats(int stream_id) {
+  StreamStats stats{0, 0, 0.0, 0.0, 0.0, 0.0};
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) return stats;
+  auto& stream = *it->second;
+  stats.frames = stream.frames;
+  stats.pending = stream.jobs.size();
+  if (stream.frames) {
+    stats.queue_avg = stream.queue_sum / stream.frames;
+    stats.update_avg = stream.update_sum / stream.frames;
+  }
+  stats.queue_max = stream.queue_max;
+  stats.update_max = stream.update_max;
+  return stats;
+}
+
+void ReidTrackerManagerImp::Run() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    cv_.wait(lock, [this] { return stop_ || !ready_.empty(); });
+    if (ready_.empty()) return;
+    auto stream = std::move(ready_.front());
+    ready_.pop_front();
+    // the job stays at the front of the queue until it is done, so pending
+    // counts it; only this worker touches it meanwhile
+    auto& job = stream->jobs.front();
+    lock.unlock();
+
+    auto start = Clock::now();
+    std::exception_ptr error;
+    try {
+      stream->tracker->track(job.frame_id, job.detections, job.count,
+                             job.is_detection, job.is_normalized,
+                             *job.output_characts, job.detection_results);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    auto end = Clock::now();
+
+    lock.lock();
+    double queue =
+        std::chrono::duration<double, std::micro>(start - job.submitted)
+            .count();
+    double update = std::chrono::duration<double, std::micro>(end - start)
+                        .count();
+    stream->frames += 1;
+    stream->queue_sum += queue;
+    stream->queue_max = std::max(stream->queue_max, queue);
+    stream->update_sum += update;
+    stream->update_max = std::max(stream->update_max, update);
+    // the stats are complete before the caller is woken
+    uint64_t frame_id = job.frame_id;
+    auto done = std::move(job.done);
+    stream->jobs.pop_front();
+    if (stream->jobs.empty()) {
+      stream->scheduled = false;
+    } else {
+      ready_.push_back(std::move(stream));
+      cv_.notify_one();
+    }
+    lock.unlock();
+    if (error) {
+      done.set_exception(error);
+    } else {
+      done.set_value(frame_id);
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace ai
+}  // namespace vitis
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/vitis/ai/reidtracker.hpp"
+#include "common.hpp"
+
+namespace vitis {
+namespace ai {
+
+class ReidTrackerManagerImp : public ReidTrackerManager {
+ public:
+  ReidTrackerManagerImp(int workers, uint64_t mode,
+                        const ReidTracker::SpecifiedCfg& cfg);
+  ReidTrackerManagerImp(const ReidTrackerManagerImp&) = delete;
+  ReidTrackerManagerImp& operator=(const ReidTrackerManagerImp&) = delete;
+  virtual ~ReidTrackerManagerImp();
+
+  virtual std::shared_ptr<ReidTracker> tracker(int stream_id) override;
+  virtual bool removeStream(int stream_id) override;
+  virtual std::future<uint64_t> track(
+      int stream_id, const ReidTracker::Detection* detections, size_t count,
+      const bool is_detection, const bool is_normalized,
+      std::vector<ReidTracker::OutputCharact>& output_characts,
+      ReidTracker::DetectionResult* detection_results = nullptr) override;
+  virtual StreamStats stats(int stream_id) override;
+
+ private:
+  struct Job {
+    uint64_t frame_id;
+    const ReidTracker::Detection* detections;
+    size_t count;
+    bool is_detection;
+    bool is_normalized;
+    std::vector<ReidTracker::OutputCharact>* output_characts;
+    ReidTracker::DetectionResult* detection_results;
+    Clock::time_point submitted;
+    std::promise<uint64_t> done;
+  };
+  // Jobs of a stream run one at a time: a stream with jobs is either in
+  // ready_ or owned by the worker running its front job, never both.
+  struct Stream {
+    std::shared_ptr<ReidTracker> tracker;
+    uint64_t frame_id = 0;
+    std::deque<Job> jobs;
+    bool scheduled = false;
+    uint64_t frames = 0;
+    double queue_sum = 0.0, queue_max = 0.0;
+    double update_sum = 0.0, update_max = 0.0;
+  };
+  // requires mtx_
+  std::shared_ptr<Stream>& GetStream(int stream_id);
+  void Run();
+
+  uint64_t mode_;
+  ReidTracker::SpecifiedCfg cfg_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::map<int, std::shared_ptr<Stream>> streams_;
+  std::deque<std::shared_ptr<Stream>> ready_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace ai
+}  // namespace vitis
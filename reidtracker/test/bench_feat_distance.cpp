@@ -0,0 +1,104 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_distance.hpp"
+#include "feat_reference.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+using namespace std::chrono;
+
+// Random unit-norm features, like the output of the reid model.
+static vector<float> make_feats(int rows, int dim, mt19937 &gen) {
+  normal_distribution<float> dist(0.f, 1.f);
+  vector<float> feats(rows * dim);
+  for (int i = 0; i < rows; ++i) {
+    double norm = 0;
+    for (int k = 0; k < dim; ++k) {
+      feats[i * dim + k] = dist(gen);
+      norm += feats[i * dim + k] * feats[i * dim + k];
+    }
+    for (int k = 0; k < dim; ++k) feats[i * dim + k] /= sqrt(norm);
+  }
+  return feats;
+}
+
+int main(int argc, char **argv) {
+  int dim = argc > 1 ? atoi(argv[1]) : 512;
+  int loops = argc > 2 ? atoi(argv[2]) : 200;
+  mt19937 gen(0);
+  cout << "dim " << dim << ", " << loops << " loops" << endl;
+  int failed = 0;
+  for (int ntrack : {10, 50, 200}) {
+    int ndet = ntrack;
+    auto tracks = make_feats(ntrack, dim, gen);
+    auto dets = make_feats(ndet, dim, gen);
+    vector<float> ref(ntrack * ndet), out(ntrack * ndet), spec(ntrack * ndet);
+    // what the gallery picks for this dim, generic for unusual dims
+    const FeatKernels &kernels = FeatKernelsFor(dim);
+
+    auto t0 = steady_clock::now();
+    for (int l = 0; l < loops; ++l) {
+      dist_matrix_scalar(tracks.data(), ntrack, dim, dets.data(), ndet, dim,
+                         dim, ref.data(), ndet);
+    }
+    auto t1 = steady_clock::now();
+    // unit rows, no norms, one dot product per pair
+    for (int l = 0; l < loops; ++l) {
+      FeatDotMatrix(tracks.data(), ntrack, dim, dets.data(), ndet, dim, dim,
+                    out.data(), ndet);
+      for (auto &d : out) d = FeatUnitDistance(d);
+    }
+    auto t2 = steady_clock::now();
+    // the gallery path
+    for (int l = 0; l < loops; ++l) {
+      kernels.dot_matrix(tracks.data(), ntrack, dim, dets.data(), ndet, dim,
+                         dim, spec.data(), ndet);
+      for (auto &d : spec) d = FeatUnitDistance(d);
+    }
+    auto t3 = steady_clock::now();
+
+    float max_err = 0.f;
+    for (size_t i = 0; i < ref.size(); ++i)
+      max_err = max(max_err, fabs(ref[i] - out[i]));
+    bool same = solve(ref, ntrack, ndet) == solve(out, ntrack, ndet);
+    float spec_err = 0.f;
+    for (size_t i = 0; i < ref.size(); ++i)
+      spec_err = max(spec_err, fabs(ref[i] - spec[i]));
+    bool spec_same = solve(ref, ntrack, ndet) == solve(spec, ntrack, ndet);
+    double scalar_us = duration_cast<microseconds>(t1 - t0).count() /
+                       double(loops);
+    double dot_us = duration_cast<microseconds>(t2 - t1).count() /
+                        double(loops);
+    double spec_us = duration_cast<microseconds>(t3 - t2).count() /
+                     double(loops);
+    cout << ntrack << " tracks x " << ndet << " dets: scalar " << scalar_us
+         << " us, unit dot " << dot_us << " us, speedup "
+         << scalar_us / dot_us << "x, max err " << max_err
+         << ", assignment " << (same ? "same" : "DIFFERENT") << endl;
+    cout << "  unit dot, dim " << (kernels.dim ? "specialized" : "generic")
+         << " " << spec_us << " us, max err " << spec_err << ", assignment "
+         << (spec_same ? "same" : "DIFFERENT") << endl;
+    if (!same || !spec_same) ++failed;
+  }
+  return failed ? 1 : 0;
+}
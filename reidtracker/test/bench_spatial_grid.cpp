@@ -0,0 +1,101 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_grid.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+using namespace std::chrono;
+
+// same tests as FTD_Structure::Update
+static float iou(const cv::Rect_<float> &a, const cv::Rect_<float> &b) {
+  float inner = (a & b).area();
+  return inner / (a.area() + b.area() - inner);
+}
+static float center_in(const cv::Rect_<float> &a, const cv::Rect_<float> &b) {
+  float cx = a.x + a.width * 0.5;
+  float cy = a.y + a.height * 0.5;
+  return cx >= b.x && cx <= b.x + b.width && cy >= b.y &&
+         cy <= b.y + b.height;
+}
+
+int main(int argc, char **argv) {
+  int loops = argc > 1 ? atoi(argv[1]) : 200;
+  mt19937 gen(0);
+  uniform_real_distribution<float> pos(0.f, 0.95f);
+  uniform_real_distribution<float> size(0.02f, 0.06f);
+  normal_distribution<float> jitter(0.f, 0.005f);
+  FTD_Grid grid;
+  vector<int> candidates;
+  int failed = 0;
+  for (int n : {100, 200, 500, 1000}) {
+    // pedestrians-like boxes, detections are jittered predictions
+    vector<cv::Rect_<float>> tracks, dets;
+    for (int i = 0; i < n; ++i) {
+      float w = size(gen);
+      tracks.emplace_back(pos(gen), pos(gen), w, w * 2.5f);
+      auto d = tracks.back();
+      dets.emplace_back(d.x + jitter(gen), d.y + jitter(gen), d.width,
+                        d.height);
+    }
+    vector<double> dense_iou(n * n), dense_center(n * n);
+    vector<double> grid_iou(n * n), grid_center(n * n);
+
+    auto t0 = steady_clock::now();
+    for (int l = 0; l < loops; ++l) {
+      for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j) {
+          dense_iou[i * n + j] = 1.0f - iou(tracks[i], dets[j]);
+          dense_center[i * n + j] = center_in(dets[j], tracks[i]);
+        }
+    }
+    auto t1 = steady_clock::now();
+    size_t pairs = 0;
+    for (int l = 0; l < loops; ++l) {
+      grid_iou.assign(n * n, 1.0);
+      grid_center.assign(n * n, 0.0);
+      grid.Build(tracks);
+      pairs = 0;
+      for (int j = 0; j < n; ++j) {
+        candidates.clear();
+        grid.Query(dets[j], candidates);
+        pairs += candidates.size();
+        for (int i : candidates) {
+          grid_iou[i * n + j] = 1.0f - iou(tracks[i], dets[j]);
+          grid_center[i * n + j] = center_in(dets[j], tracks[i]);
+        }
+      }
+    }
+    auto t2 = steady_clock::now();
+
+    bool same = dense_iou == grid_iou && dense_center == grid_center;
+    double dense_us =
+        duration_cast<microseconds>(t1 - t0).count() / double(loops);
+    double grid_us =
+        duration_cast<microseconds>(t2 - t1).count() / double(loops);
+    cout << n << " objects: dense " << dense_us << " us, grid " << grid_us
+         << " us (" << pairs << " of " << n * n << " pairs tested), speedup "
+         << dense_us / grid_us << "x, matrices "
+         << (same ? "same" : "DIFFERENT") << endl;
+    if (!same) ++failed;
+  }
+  return failed ? 1 : 0;
+}
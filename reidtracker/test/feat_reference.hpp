@@ -0,0 +1,57 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _FEAT_REFERENCE_HPP_
+#define _FEAT_REFERENCE_HPP_
+
+#include <cmath>
+#include <vector>
+
+#include "../src/ftd/ftd_hungarian.hpp"
+
+// Reference for the feature kernels shared by the tests and benchmarks:
+// the Euclidean distance of every row of a (na x dim) to every row of b
+// (nb x dim), one pair at a time with double accumulation, written
+// row-major to dist (na x nb, leading dimension ldd).
+inline void dist_matrix_scalar(const float *a, int na, int lda,
+                               const float *b, int nb, int ldb, int dim,
+                               float *dist, int ldd) {
+  for (int i = 0; i < na; ++i) {
+    for (int j = 0; j < nb; ++j) {
+      double sumvalue = 0;
+      for (int k = 0; k < dim; ++k) {
+        double d = a[i * lda + k] - b[j * ldb + k];
+        sumvalue += d * d;
+      }
+      dist[i * ldd + j] = std::sqrt(sumvalue);
+    }
+  }
+}
+
+// The Hungarian assignment of dist (rows x cols), to compare distance
+// matrices by their outcome.
+inline std::vector<int> solve(const std::vector<float> &dist, int rows,
+                              int cols) {
+  std::vector<std::vector<double>> mat(rows, std::vector<double>(cols));
+  for (int i = 0; i < rows; ++i)
+    for (int j = 0; j < cols; ++j) mat[i][j] = dist[i * cols + j];
+  FtdHungarian hung;
+  std::vector<int> assignment;
+  hung.Solve(mat, assignment);
+  return assignment;
+}
+
+#endif
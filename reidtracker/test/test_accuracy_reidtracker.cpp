@@ -66,6 +66,7 @@ priority_queue<imagePair, vector<imagePair>, paircomp>
 
 /* Base parameter and image path.*/
 string baseImagePath;
+string outfile;
 vector<string> images;
 vector<Mat> read_imgs;
 void reader() {
@@ -151,8 +152,10 @@ void run() {
     exit(0);
   }
   std::vector<vitis::ai::ReidTracker::InputCharact> input_characts;
-  string outfile =
-      "MOT-" + baseImagePath.substr(baseImagePath.size() - 3, 2) + ".txt";
+  // optional output file, defaults to MOT-XX.txt
+  if (outfile.empty())
+    outfile =
+        "MOT-" + baseImagePath.substr(baseImagePath.size() - 3, 2) + ".txt";
   ofstream of(outfile);
   while (1) {
     pair<int, Mat> pairIndexImage;
@@ -234,11 +237,12 @@ void run() {
 }
 
 int main(int argc, char** argv) {
-  if (argc != 2) {
+  if (argc != 2 && argc != 3) {
     cout << "Please set input image. " << endl;
     return 0;
   }
   baseImagePath = string(argv[1]);
+  if (argc == 3) outfile = string(argv[2]);
   std::ifstream fs(baseImagePath + "/list.txt");
   std::string line;
   while (getline(fs, line)) {
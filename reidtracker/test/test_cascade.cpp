@@ -0,0 +1,113 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+
+using namespace std;
+using namespace vitis::ai;
+
+// A corridor: people walk along the corridor in both directions, so most
+// boxes overlap only their own track and are matched on geometry, while
+// every pair that passes each other has to be told apart by appearance.
+// Every person must keep one gid from its confirmation on.
+int main(int argc, char **argv) {
+  // environment parameters are read once, before the first tracker
+  setenv("REID_TRACKER_CASCADE", "70", 0);
+  int npeople = argc > 1 ? atoi(argv[1]) : 12;
+  int frames = argc > 2 ? atoi(argv[2]) : 600;
+  int dim = 128;
+  mt19937 gen(7);
+  normal_distribution<float> noise(0.f, 1.f);
+  uniform_real_distribution<float> uniform(0.f, 1.f);
+  struct Person {
+    float x, y, vx;
+    vector<float> feat;
+  };
+  vector<Person> people(npeople);
+  for (int p = 0; p < npeople; ++p) {
+    auto &person = people[p];
+    // two lanes that overlap, walking towards each other
+    person.x = uniform(gen) * 0.9f;
+    person.y = 0.4f + (p % 2) * 0.03f;
+    person.vx = (p % 2 ? -1.f : 1.f) * (0.002f + 0.002f * uniform(gen));
+    person.feat.resize(dim);
+    double norm = 0;
+    for (auto &v : person.feat) {
+      v = noise(gen);
+      norm += v * v;
+    }
+    for (auto &v : person.feat) v /= sqrt(norm);
+  }
+
+  auto tracker = ReidTracker::create();
+  vector<vector<float>> feats(npeople, vector<float>(dim));
+  vector<ReidTracker::Detection> detections;
+  vector<ReidTracker::OutputCharact> output;
+  map<int, uint64_t> gid_of;
+  int switches = 0, reported = 0, detected = 0;
+  auto start = chrono::steady_clock::now();
+  for (int f = 1; f <= frames; ++f) {
+    detections.clear();
+    for (int p = 0; p < npeople; ++p) {
+      auto &person = people[p];
+      person.x += person.vx;
+      if (person.x < 0.f || person.x > 0.95f) person.vx = -person.vx;
+      if (uniform(gen) < 0.05f) continue;  // missed detection
+      double norm = 0;
+      for (int k = 0; k < dim; ++k) {
+        feats[p][k] = person.feat[k] + 0.03f * noise(gen);
+        norm += feats[p][k] * feats[p][k];
+      }
+      for (auto &v : feats[p]) v /= sqrt(norm);
+      cv::Rect_<float> box(person.x + 0.001f * noise(gen),
+                           person.y + 0.001f * noise(gen), 0.04f, 0.1f);
+      detections.push_back({feats[p].data(), dim, box, 0.9f, 1, p});
+    }
+    detected += detections.size();
+    tracker->track(f, detections.data(), detections.size(), true, true,
+                   output);
+    for (auto &out : output) {
+      int p = get<4>(out);
+      if (p < 0) continue;
+      reported++;
+      auto it = gid_of.find(p);
+      if (it == gid_of.end()) {
+        gid_of[p] = get<0>(out);
+      } else if (it->second != get<0>(out)) {
+        switches++;
+        it->second = get<0>(out);
+      }
+    }
+  }
+  double ms = chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                              start)
+                  .count();
+  bool ok = switches == 0 && (int)gid_of.size() == npeople &&
+            reported > 0.9 * detected;
+  cout << npeople << " people, " << frames << " frames: " << switches
+       << " id switches, " << reported << " of " << detected
+       << " detections reported, " << ms / frames << " ms per frame" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
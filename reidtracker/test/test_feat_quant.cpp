@@ -0,0 +1,169 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_distance.hpp"
+#include "feat_reference.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+using namespace std::chrono;
+
+// Unit-norm track features and detections close to them, like consecutive
+// outputs of the reid model for the same people.
+static void make_feats(int rows, int dim, mt19937 &gen, vector<float> &tracks,
+                       vector<float> &dets) {
+  normal_distribution<float> dist(0.f, 1.f);
+  tracks.resize(rows * dim);
+  dets.resize(rows * dim);
+  for (auto *m : {&tracks, &dets}) {
+    for (int i = 0; i < rows; ++i) {
+      double norm = 0;
+      for (int k = 0; k < dim; ++k) {
+        float v = dist(gen);
+        if (m == &dets) v = tracks[i * dim + k] * 20.f + v;
+        (*m)[i * dim + k] = v;
+        norm += v * v;
+      }
+      for (int k = 0; k < dim; ++k) (*m)[i * dim + k] /= sqrt(norm);
+    }
+  }
+}
+
+static bool check_half_conversion() {
+  // every finite half survives half -> float -> half, through both the
+  // vector and the scalar tail path (blocks of 5)
+  int failed = 0;
+  for (int h = 0; h < 0x10000; h += 5) {
+    uint16_t in[5], out[5];
+    float f[5];
+    for (int k = 0; k < 5; ++k) {
+      in[k] = (h + k) & 0xffff;
+      if ((in[k] & 0x7c00) == 0x7c00) in[k] = 0;  // skip inf / nan
+    }
+    HalfToFeat(in, 5, f);
+    FeatToHalf(f, 5, out);
+    for (int k = 0; k < 5; ++k) failed += in[k] != out[k];
+  }
+  // rounding agrees between the vector and the scalar path
+  mt19937 gen(1);
+  uniform_real_distribution<float> value(-4.f, 4.f);
+  for (int c = 0; c < 10000; ++c) {
+    float f[5];
+    uint16_t vec[5], tail;
+    for (auto &v : f) v = value(gen);
+    FeatToHalf(f, 5, vec);
+    FeatToHalf(f + 4, 1, &tail);
+    failed += vec[4] != tail;
+    for (int k = 0; k < 4; ++k) {
+      FeatToHalf(f + k, 1, &tail);
+      failed += vec[k] != tail;
+    }
+  }
+  cout << "fp16 conversion: " << (failed ? "FAILED" : "ok") << endl;
+  return failed == 0;
+}
+
+// The gallery keeps unit rows and compares them with the dot kernels
+// FeatKernelsFor picks for the dim; 500 takes the generic ones. The generic
+// kernels are also checked at the specialized dims.
+int main(int argc, char **argv) {
+  int loops = argc > 1 ? atoi(argv[1]) : 100;
+  bool ok = check_half_conversion();
+  mt19937 gen(0);
+  for (int dim : {128, 256, 512, 500}) {
+    int n = 100;
+    vector<float> tracks, dets;
+    make_feats(n, dim, gen, tracks, dets);
+    vector<float> ts(n), ds(n);
+    vector<uint16_t> th(n * dim), dh(n * dim);
+    vector<int8_t> tq(n * dim), dq(n * dim);
+    for (int i = 0; i < n; ++i) {
+      FeatToHalf(&tracks[i * dim], dim, &th[i * dim]);
+      FeatToHalf(&dets[i * dim], dim, &dh[i * dim]);
+      ts[i] = FeatToInt8(&tracks[i * dim], dim, &tq[i * dim]);
+      ds[i] = FeatToInt8(&dets[i * dim], dim, &dq[i * dim]);
+    }
+    // the integer kernel is exact
+    for (int i = 0; i < n; ++i) {
+      int32_t ref = 0;
+      for (int k = 0; k < dim; ++k) ref += tq[i * dim + k] * dq[i * dim + k];
+      if (ref != FeatDotInt8(&tq[i * dim], &dq[i * dim], dim)) ok = false;
+    }
+
+    vector<float> ref(n * n), f32(n * n), f16(n * n), i8(n * n);
+    dist_matrix_scalar(tracks.data(), n, dim, dets.data(), n, dim, dim,
+                       ref.data(), n);
+    auto report = [&](const char *name, vector<float> &out,
+                      steady_clock::time_point a, steady_clock::time_point b,
+                      float tolerance) {
+      for (auto &d : out) d = FeatUnitDistance(d);
+      float max_err = 0.f;
+      for (size_t i = 0; i < ref.size(); ++i)
+        max_err = max(max_err, fabs(ref[i] - out[i]));
+      bool same = solve(ref, n, n) == solve(out, n, n);
+      double us = duration_cast<microseconds>(b - a).count() / double(loops);
+      cout << "  " << name << ": " << us << " us, max err " << max_err
+           << ", assignment " << (same ? "same" : "DIFFERENT") << endl;
+      if (!same || max_err > tolerance) ok = false;
+    };
+    const FeatKernels &kernels = FeatKernelsFor(dim);
+    cout << "dim " << dim << ", " << n << " x " << n << ", "
+         << (kernels.dim ? "specialized" : "generic") << " kernels" << endl;
+    auto t0 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      kernels.dot_matrix(tracks.data(), n, dim, dets.data(), n, dim, dim,
+                         f32.data(), n);
+    auto t1 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      kernels.dot_matrix_half(th.data(), n, dim, dh.data(), n, dim, dim,
+                              f16.data(), n);
+    auto t2 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      kernels.dot_matrix_int8(tq.data(), ts.data(), n, dim, dq.data(),
+                              ds.data(), n, dim, dim, i8.data(), n);
+    auto t3 = steady_clock::now();
+    report("fp32", f32, t0, t1, 1e-4f);
+    report("fp16", f16, t1, t2, 2e-3f);
+    report("int8", i8, t2, t3, 2e-2f);
+    if (!kernels.dim) continue;
+
+    cout << "  generic kernels" << endl;
+    t0 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      FeatDotMatrix(tracks.data(), n, dim, dets.data(), n, dim, dim,
+                    f32.data(), n);
+    t1 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      FeatDotMatrixHalf(th.data(), n, dim, dh.data(), n, dim, dim, f16.data(),
+                        n);
+    t2 = steady_clock::now();
+    for (int l = 0; l < loops; ++l)
+      FeatDotMatrixInt8(tq.data(), ts.data(), n, dim, dq.data(), ds.data(), n,
+                        dim, dim, i8.data(), n);
+    t3 = steady_clock::now();
+    report("fp32", f32, t0, t1, 1e-4f);
+    report("fp16", f16, t1, t2, 2e-3f);
+    report("int8", i8, t2, t3, 2e-2f);
+  }
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_gallery.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+static vector<float> unit(int dim, mt19937 &gen) {
+  normal_distribution<float> dist(0.f, 1.f);
+  vector<float> v(dim);
+  double norm = 0;
+  for (auto &x : v) {
+    x = dist(gen);
+    norm += x * x;
+  }
+  for (auto &x : v) x /= sqrt(norm);
+  return v;
+}
+
+static float l2(const vector<float> &a, const vector<float> &b) {
+  double sum = 0;
+  for (size_t k = 0; k < a.size(); ++k) sum += (a[k] - b[k]) * (a[k] - b[k]);
+  return sqrt(sum);
+}
+
+// Feeds the same features to a gallery with k exemplars and checks the
+// distances against a brute force minimum over the features it kept.
+static bool check(int bits, int k, int dim, float tolerance) {
+  mt19937 gen(bits * 100 + k);
+  FTD_Gallery gallery;
+  gallery.SetBits(bits);
+  gallery.SetExemplars(k, 0.3f, 0);
+  int ntrack = 20, nquery = 15;
+  vector<vector<vector<float>>> kept(ntrack);
+  vector<int> slots;
+  for (int t = 0; t < ntrack; ++t) {
+    int slot = gallery.Alloc();
+    slots.push_back(slot);
+    auto f = unit(dim, gen);
+    gallery.Init(slot, f.data(), dim);
+    kept[slot].push_back(f);
+    // half of the updates are novel
+    for (int u = 0; u < 10; ++u) {
+      auto g = u % 2 ? unit(dim, gen) : kept[slot][0];
+      gallery.AddExemplar(slot, g.data());
+      bool novel = true;
+      for (auto &e : kept[slot]) novel = novel && l2(e, g) > 0.3f;
+      if (!novel || k == 1) continue;
+      if ((int)kept[slot].size() < k) {
+        kept[slot].push_back(g);
+      } else {
+        // ring over exemplars 1 .. k - 1, the anchor is kept
+        kept[slot].erase(kept[slot].begin() + 1);
+        kept[slot].push_back(g);
+      }
+    }
+  }
+  vector<vector<float>> queries;
+  gallery.ResizeQueries(nquery);
+  for (int q = 0; q < nquery; ++q) {
+    // queries near some kept exemplar
+    auto &e = kept[q % ntrack][q % kept[q % ntrack].size()];
+    auto noise = unit(dim, gen);
+    vector<float> v(dim);
+    double norm = 0;
+    for (int d = 0; d < dim; ++d) {
+      v[d] = e[d] + 0.2f * noise[d];
+      norm += v[d] * v[d];
+    }
+    for (auto &x : v) x /= sqrt(norm);
+    queries.push_back(v);
+    gallery.SetQuery(q, v.data());
+  }
+  vector<float> dot(gallery.rows() * nquery);
+  gallery.QueryDotMatrix(dot.data(), nquery);
+  bool ok = true;
+  float max_err = 0.f;
+  for (int slot : slots) {
+    if (gallery.ExemplarCount(slot) != (int)kept[slot].size()) ok = false;
+    for (int q = 0; q < nquery; ++q) {
+      float ref = 1e9f;
+      for (auto &e : kept[slot]) ref = min(ref, l2(e, queries[q]));
+      float dist = FeatUnitDistance(dot[slot * nquery + q]);
+      max_err = max(max_err, fabs(ref - dist));
+      max_err = max(max_err, fabs(ref - gallery.QueryDistance(slot, q)));
+    }
+  }
+  ok = ok && max_err <= tolerance;
+  cout << bits << " bit, k " << k << ": max err " << max_err << " "
+       << (ok ? "ok" : "FAILED") << endl;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  bool ok = true;
+  for (int k : {1, 2, 4, 8}) {
+    ok = check(32, k, 128, 1e-4f) && ok;
+    ok = check(16, k, 128, 2e-3f) && ok;
+    ok = check(8, k, 128, 2e-2f) && ok;
+  }
+  // the memory bound lowers k: 512 floats are 2 KiB per row, 8 KiB leave
+  // room for 3 exemplars next to the EMA
+  FTD_Gallery bounded;
+  bounded.SetExemplars(8, 0.3f, 8 * 1024);
+  vector<float> f(512, 0.f);
+  f[0] = 1.f;
+  bounded.Init(bounded.Alloc(), f.data(), 512);
+  if (bounded.exemplars() != 3) ok = false;
+  cout << "bounded to " << bounded.exemplars() << " exemplars" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_filter_kalman.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+static float center_error(const cv::Rect_<float> &a,
+                          const cv::Rect_<float> &b) {
+  return hypot(a.x + a.width / 2 - b.x - b.width / 2,
+               a.y + a.height / 2 - b.y - b.height / 2);
+}
+
+// Boxes move at constant velocity and are detected with noise on every
+// `every`-th frame only; the predictions of the filter must beat holding the
+// last detection, in normalized and in pixel coordinates.
+static bool check(float scale, int every) {
+  mt19937 gen(every);
+  normal_distribution<float> noise(0.f, 0.002f * scale);
+  int n = 16, frames = 120;
+  vector<cv::Rect_<float>> truth(n), last(n);
+  vector<float> vx(n), vy(n);
+  FTD_KalmanModels kalman;
+  kalman.Resize(n);
+  for (int i = 0; i < n; ++i) {
+    truth[i] = cv::Rect_<float>(0.1f * scale + 0.04f * i * scale, 0.2f * scale,
+                                0.04f * scale, 0.1f * scale);
+    vx[i] = (i % 5 - 2) * 0.002f * scale;
+    vy[i] = (i % 3 - 1) * 0.003f * scale;
+    kalman.Init(i, truth[i]);
+    last[i] = truth[i];
+  }
+  vector<int> rows(n);
+  vector<cv::Rect_<float>> dets(n);
+  double kalman_err = 0, hold_err = 0;
+  int count = 0;
+  for (int f = 1; f <= frames; ++f) {
+    for (int i = 0; i < n; ++i) {
+      truth[i].x += vx[i];
+      truth[i].y += vy[i];
+    }
+    kalman.Predict();
+    for (int i = 0; i < n; ++i) {
+      if (kalman.bad[i]) return false;
+      // skip the start, the velocity is unknown there
+      if (f > 30) {
+        kalman_err += center_error(kalman.Box(i), truth[i]);
+        hold_err += center_error(last[i], truth[i]);
+        count++;
+      }
+    }
+    if (f % every) continue;
+    for (int i = 0; i < n; ++i) {
+      rows[i] = i;
+      dets[i] = truth[i];
+      dets[i].x += noise(gen);
+      dets[i].y += noise(gen);
+      last[i] = dets[i];
+    }
+    kalman.Update(rows.data(), dets.data(), n);
+  }
+  kalman_err /= count * scale;
+  hold_err /= count * scale;
+  bool ok = kalman_err < 0.5 * hold_err;
+  cout << "scale " << scale << ", detection every " << every
+       << " frames: kalman error " << kalman_err << ", hold error "
+       << hold_err << (ok ? "" : " FAILED") << endl;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  bool ok = true;
+  for (float scale : {1.f, 1920.f})
+    for (int every : {1, 3, 6}) ok = check(scale, every) && ok;
+
+  // moving a row carries its state, an empty box is flagged
+  FTD_KalmanModels kalman;
+  kalman.Resize(2);
+  kalman.Init(0, cv::Rect_<float>(0.1f, 0.1f, 0.1f, 0.2f));
+  kalman.Init(1, cv::Rect_<float>(0.5f, 0.5f, 0.1f, 0.2f));
+  kalman.Move(1, 0);
+  kalman.Resize(1);
+  kalman.Predict();
+  ok = ok && kalman.Box(0).x > 0.45f && !kalman.bad[0];
+  SpecifiedCfg linear(std::array<int, 4>({3, 3, 1, 1}),
+                      std::array<int, 3>({3, 2, 1}));
+  SpecifiedCfg zeros(std::array<int, 4>({0, 0, 0, 0}),
+                     std::array<int, 3>({3, 2, 1}));
+  ok = ok && !FTD_KalmanModels::Selected(linear) &&
+       FTD_KalmanModels::Selected(zeros);
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+
+using namespace std;
+using namespace vitis::ai;
+
+// Two objects of different labels that look the same: the first one leaves
+// the frame and the second one shows up far from it. The appearance passes
+// must not hand the track of the first one to the second one, whose label
+// differs. "cascade" as first argument runs the cascade association.
+int main(int argc, char **argv) {
+  // environment parameters are read once, before the first tracker
+  if (argc > 1 && string(argv[1]) == "cascade")
+    setenv("REID_TRACKER_CASCADE", "70", 1);
+  int dim = 128;
+  mt19937 gen(3);
+  normal_distribution<float> noise(0.f, 1.f);
+  vector<float> feat(dim);
+  double norm = 0;
+  for (auto &v : feat) {
+    v = noise(gen);
+    norm += v * v;
+  }
+  for (auto &v : feat) v /= sqrt(norm);
+
+  auto tracker = ReidTracker::create();
+  vector<ReidTracker::Detection> detections(1);
+  vector<ReidTracker::OutputCharact> output;
+  uint64_t first_gid = 0;
+  int second_reported = 0, wrong = 0;
+  for (int f = 1; f <= 60; ++f) {
+    // label 1 on the left for 30 frames, then label 2 on the right
+    bool first = f <= 30;
+    cv::Rect_<float> box(first ? 0.1f + 0.002f * f : 0.7f, 0.4f, 0.04f, 0.1f);
+    detections[0] = {feat.data(), dim, box, 0.9f, first ? 1 : 2, f};
+    tracker->track(f, detections.data(), detections.size(), true, true,
+                   output);
+    for (auto &out : output) {
+      if (first) {
+        first_gid = get<0>(out);
+        continue;
+      }
+      second_reported++;
+      if (get<3>(out) != 2 || get<0>(out) == first_gid) wrong++;
+    }
+  }
+  bool ok = first_gid != 0 && second_reported > 0 && wrong == 0;
+  cout << "first gid " << first_gid << ", second object reported "
+       << second_reported << " times, " << wrong << " with the first track"
+       << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
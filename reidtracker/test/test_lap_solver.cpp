@@ -0,0 +1,110 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "../src/ftd/ftd_hungarian.hpp"
+#include "../src/ftd/ftd_lap.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// count heap allocations to check the solver's steady state
+static atomic<long> alloc_count(0);
+void *operator new(size_t size) {
+  alloc_count++;
+  void *p = malloc(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static double cost_of(const vector<vector<double>> &mat,
+                      const vector<int> &assignment, int &matched) {
+  double cost = 0;
+  matched = 0;
+  for (size_t i = 0; i < assignment.size(); ++i) {
+    if (assignment[i] < 0) continue;
+    cost += mat[i][assignment[i]];
+    matched++;
+  }
+  return cost;
+}
+
+int main(int argc, char **argv) {
+  int cases = argc > 1 ? atoi(argv[1]) : 2000;
+  mt19937 gen(0);
+  uniform_int_distribution<int> dim(1, 40);
+  uniform_real_distribution<double> value(0.0, 2.0);
+  // a quarter of the cases use few distinct values, like the masked
+  // iou / feature matrices in the tracker, to exercise ties
+  uniform_int_distribution<int> level(0, 4);
+
+  FtdLapSolver lap;
+  int failed = 0;
+  for (int c = 0; c < cases; ++c) {
+    int rows = dim(gen), cols = dim(gen);
+    bool ties = c % 4 == 0;
+    vector<vector<double>> mat(rows, vector<double>(cols));
+    for (auto &row : mat)
+      for (auto &v : row) v = ties ? level(gen) * 0.5 : value(gen);
+
+    vector<int> ref, out;
+    FtdHungarian hung;
+    hung.Solve(mat, ref);
+    lap.Solve(mat, out);
+
+    int ref_matched, out_matched;
+    double ref_cost = cost_of(mat, ref, ref_matched);
+    double out_cost = cost_of(mat, out, out_matched);
+    vector<int> used(cols, 0);
+    bool valid = (int)out.size() == rows;
+    for (int a : out) {
+      if (a >= 0 && used[a]++) valid = false;
+    }
+    if (!valid || ref_matched != out_matched ||
+        fabs(ref_cost - out_cost) > 1e-9) {
+      failed++;
+      cerr << "case " << c << " (" << rows << "x" << cols
+           << "): munkres cost " << ref_cost << " matched " << ref_matched
+           << ", lap cost " << out_cost << " matched " << out_matched << endl;
+    }
+  }
+  cout << cases - failed << "/" << cases << " cases match munkres" << endl;
+
+  // after warm-up on the largest size, smaller problems must not allocate
+  vector<vector<double>> big(40, vector<double>(40));
+  for (auto &row : big)
+    for (auto &v : row) v = value(gen);
+  vector<int> assignment;
+  lap.Solve(big, assignment);
+  long before = alloc_count;
+  for (int c = 0; c < 100; ++c) {
+    big.resize(1 + c % 40);
+    lap.Solve(big, assignment);
+  }
+  long allocs = alloc_count - before;
+  cout << allocs << " allocations in 100 steady-state solves" << endl;
+
+  return (failed == 0 && allocs == 0) ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+#include "walk_scene.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// A crowded square: npeople wander in a small area, so every frame has
+// npeople x npeople pairs to score. The environment is read once per
+// process, so the test runs itself once with the matrices built on one
+// thread and once on the workers, and compares a hash of every output.
+static int child(int npeople, int frames) {
+  WalkOptions options;
+  options.dim = 256;
+  options.seed = 11;
+  options.speed = 0.004f;
+  options.feat_noise = 0.8f;
+  options.miss = 0.05f;
+  options.width = 0.05f;
+  options.height = 0.15f;
+  WalkScene scene(npeople, options);
+  auto tracker = ReidTracker::create();
+  Outputs output;
+  uint64_t hash = kOutputsHash;
+  double ms = 0;
+  for (int f = 1; f <= frames; ++f) {
+    scene.Next();
+    auto &dets = scene.detections();
+    auto start = chrono::steady_clock::now();
+    tracker->track(f, dets.data(), dets.size(), true, true, output);
+    ms += chrono::duration<double, milli>(chrono::steady_clock::now() - start)
+              .count();
+    HashOutputs(hash, output);
+  }
+  printf("%llu %f\n", (unsigned long long)hash, ms / frames);
+  return 0;
+}
+
+static bool run(const string &env, const string &self, int npeople,
+                int frames, uint64_t &hash, double &ms) {
+  string cmd = env + " " + self + " --child " + to_string(npeople) + " " +
+               to_string(frames);
+  FILE *pipe = popen(cmd.c_str(), "r");
+  if (!pipe) return false;
+  unsigned long long h = 0;
+  bool ok = fscanf(pipe, "%llu %lf", &h, &ms) == 2;
+  ok = pclose(pipe) == 0 && ok;
+  hash = h;
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && string(argv[1]) == "--child")
+    return child(argc > 2 ? atoi(argv[2]) : 80, argc > 3 ? atoi(argv[3]) : 200);
+  int npeople = argc > 1 ? atoi(argv[1]) : 80;
+  int frames = argc > 2 ? atoi(argv[2]) : 200;
+  uint64_t serial_hash = 0, parallel_hash = 0;
+  double serial_ms = 0, parallel_ms = 0;
+  bool ok = run("REID_TRACKER_THREADS=0", argv[0], npeople, frames,
+                serial_hash, serial_ms) &&
+            run("REID_TRACKER_THREADS=3 REID_TRACKER_PARALLEL_PAIRS=1",
+                argv[0], npeople, frames, parallel_hash, parallel_ms);
+  ok = ok && serial_hash == parallel_hash;
+  cout << npeople << " people, " << frames << " frames: " << serial_ms
+       << " ms per frame on one thread, " << parallel_ms
+       << " ms on the workers, outputs "
+       << (serial_hash == parallel_hash ? "equal" : "differ") << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
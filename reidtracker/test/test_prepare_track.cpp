@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+#include "walk_scene.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// Runs the frames on nthread detector threads in MODE_MULTIDETS mode, with
+// or without prepareTrack before the lock, and times the locked part.
+static vector<Outputs> run(const WalkFrames &scene, int nthread, bool prepare,
+                           double &locked_us) {
+  int frames = scene.size();
+  auto tracker = ReidTracker::create(ReidTracker::MODE_MULTIDETS);
+  for (int f = 1; f <= frames; ++f) tracker->addDetStart(f);
+  vector<Outputs> out(frames);
+  atomic<int> next(1);
+  atomic<int64_t> locked_ns(0);
+  vector<thread> detectors;
+  for (int t = 0; t < nthread; ++t) {
+    detectors.emplace_back([&] {
+      for (int f; (f = next++) <= frames;) {
+        auto input = scene.Input(f - 1);
+        if (prepare) tracker->prepareTrack(f, input);
+        tracker->setDetEnd(f);
+        tracker->setTrackLock(f, 5000);
+        auto start = chrono::steady_clock::now();
+        out[f - 1] = tracker->trackWithoutLock(f, input);
+        locked_ns += chrono::duration_cast<chrono::nanoseconds>(
+                         chrono::steady_clock::now() - start)
+                         .count();
+        tracker->releaseTrackLock(f);
+      }
+    });
+  }
+  for (auto &d : detectors) d.join();
+  locked_us = locked_ns / 1e3 / frames;
+  return out;
+}
+
+// Prepared frames must track exactly as unprepared ones, while the tracks
+// keep changing between the prepare and the track of a frame.
+int main(int argc, char **argv) {
+  int nobj = argc > 1 ? atoi(argv[1]) : 30;
+  int frames = argc > 2 ? atoi(argv[2]) : 300;
+  WalkOptions options;
+  options.dim = 512;
+  options.seed = 11;
+  options.feat_noise = 0.05f;
+  options.miss = 0.05f;
+  WalkScene walk(nobj, options);
+  WalkFrames scene(walk, frames);
+  double plain_us = 0, prepared_us = 0, serial_us = 0;
+  auto expected = run(scene, 1, false, serial_us);
+  auto plain = run(scene, 4, false, plain_us);
+  auto prepared = run(scene, 4, true, prepared_us);
+  int mismatch = 0;
+  for (int f = 0; f < frames; ++f)
+    mismatch += !SameOutputs(expected[f], plain[f]) +
+                !SameOutputs(expected[f], prepared[f]);
+  cout << nobj << " objects: " << plain_us << " us locked per frame, "
+       << prepared_us << " us when prepared, " << mismatch << " mismatches"
+       << endl;
+  bool ok = mismatch == 0;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/ring_queue.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// One thread pushes the results of increasing frame ids while readers look
+// up recent frames; a reader must get either nothing or the intact result
+// of the frame it asked for, and each result at most once.
+int main(int argc, char **argv) {
+  bool ok = true;
+  RingQueue<vector<uint64_t>> small(4);
+  for (uint64_t id = 1; id <= 6; ++id)
+    small.push(id, vector<uint64_t>(id, id));
+  vector<uint64_t> value;
+  // 1 and 2 were overwritten by 5 and 6
+  ok = ok && !small.take(1, value) && !small.take(2, value);
+  ok = ok && small.take(5, value) && value == vector<uint64_t>(5, 5);
+  ok = ok && !small.take(5, value);
+  int drained = 0;
+  small.drain([&](uint64_t id, vector<uint64_t> &v) {
+    ok = ok && v == vector<uint64_t>(id, id);
+    drained++;
+  });
+  ok = ok && drained == 3 && !small.take(6, value);
+
+  uint64_t frames = 200000;
+  RingQueue<vector<uint64_t>> ring(64);
+  atomic<uint64_t> latest(0);
+  atomic<uint64_t> found(0), corrupt(0);
+  vector<atomic<int>> taken(frames + 1);
+  thread producer([&] {
+    for (uint64_t id = 1; id <= frames; ++id) {
+      ring.push(id, vector<uint64_t>(1 + id % 7, id));
+      latest.store(id, memory_order_release);
+    }
+  });
+  vector<thread> readers;
+  for (int r = 0; r < 3; ++r) {
+    readers.emplace_back([&, r] {
+      vector<uint64_t> v;
+      for (;;) {
+        uint64_t last = latest.load(memory_order_acquire);
+        for (uint64_t back = r; back < 8 && back < last; ++back) {
+          uint64_t id = last - back;
+          if (!ring.take(id, v)) continue;
+          found++;
+          taken[id]++;
+          if (v != vector<uint64_t>(1 + id % 7, id)) corrupt++;
+        }
+        if (last == frames) break;
+      }
+    });
+  }
+  producer.join();
+  for (auto &reader : readers) reader.join();
+  int twice = 0;
+  for (auto &t : taken) twice += t > 1;
+  ok = ok && corrupt == 0 && twice == 0 && found > 0;
+  cout << found << " results taken, " << corrupt << " corrupt, " << twice
+       << " taken twice" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+#include "walk_scene.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+static const char *kPath = "test_snapshot.bin";
+
+// A tracker saves a snapshot at frame 60; a second one restored from it must
+// then produce exactly the output of the first on the same input.
+static bool check(const ReidTracker::SpecifiedCfg &cfg, const char *name) {
+  WalkScene scene(25);
+  auto tracker = ReidTracker::create(0, cfg);
+  Outputs output, restored_output;
+  tracker->setSnapshot(kPath, 60);
+  for (int f = 1; f <= 60; ++f) {
+    scene.Next();
+    auto &dets = scene.detections();
+    tracker->track(f, dets.data(), dets.size(), true, true, output);
+  }
+  // waits for the image of frame 60 to be written
+  tracker->setSnapshot(kPath, 0);
+  auto restored = ReidTracker::create(0, cfg);
+  bool ok = restored->restoreSnapshot(kPath);
+  int frames = 0;
+  for (int f = 61; f <= 200 && ok; ++f) {
+    scene.Next();
+    auto &dets = scene.detections();
+    tracker->track(f, dets.data(), dets.size(), true, true, output);
+    restored->track(f, dets.data(), dets.size(), true, true, restored_output);
+    ok = SameOutputs(output, restored_output);
+    frames++;
+  }
+  cout << name << ": " << frames << " frames after restore, "
+       << output.size() << " tracks, " << (ok ? "same" : "DIFFERENT")
+       << endl;
+  return ok;
+}
+
+static vector<char> read_image(const char *path) {
+  vector<char> image(1 << 20);
+  FILE *fp = fopen(path, "rb");
+  if (!fp) return {};
+  image.resize(fread(image.data(), 1, image.size(), fp));
+  fclose(fp);
+  return image;
+}
+
+static void write_image(const char *path, const vector<char> &image) {
+  FILE *fp = fopen(path, "wb");
+  fwrite(image.data(), 1, image.size(), fp);
+  fclose(fp);
+}
+
+// Restores image into a new tracker, which then has to go on tracking
+// without fault whether the image was taken or not (run under a sanitizer
+// to see the difference).
+static bool restore(const ReidTracker::SpecifiedCfg &cfg,
+                    const vector<char> &image) {
+  write_image(kPath, image);
+  auto tracker = ReidTracker::create(0, cfg);
+  bool restored = tracker->restoreSnapshot(kPath);
+  WalkScene scene(1);
+  Outputs output;
+  for (int f = 21; f <= 80; ++f) {
+    scene.Next();
+    auto &dets = scene.detections();
+    tracker->track(f, dets.data(), dets.size(), true, true, output);
+  }
+  return restored;
+}
+
+template <typename T>
+static vector<char> with(const vector<char> &image, size_t offset, T value) {
+  auto damaged = image;
+  memcpy(&damaged[offset], &value, sizeof(T));
+  return damaged;
+}
+
+// Image of one track seen for 20 frames, and its layout counted from the
+// end (float features of dim 128, one exemplar): the trajectory record, the
+// gallery slot and the linear filter, see the Save functions of each.
+static vector<char> one_track(const ReidTracker::SpecifiedCfg &cfg) {
+  WalkScene scene(1);
+  auto tracker = ReidTracker::create(0, cfg);
+  Outputs output;
+  tracker->setSnapshot(kPath, 20);
+  for (int f = 1; f <= 20; ++f) {
+    scene.Next();
+    auto &dets = scene.detections();
+    tracker->track(f, dets.data(), dets.size(), true, true, output);
+  }
+  tracker->setSnapshot(kPath, 0);
+  return read_image(kPath);
+}
+// an FTD_Window: 8 samples of 24 bytes, head, size, epoch, padding, step
+static const size_t kWindow = 216;
+static const size_t kFilter = 28 + 4 * kWindow + 3 * 64 + 32;
+static const size_t kSlot = 8 + 2 * (128 * 4 + 4);
+// FTD_KalmanModels::State, and the trajectory record after it
+static const size_t kKalmanState = 4 * (7 + 7 * 7);
+static const size_t kTrack = 55 + kSlot;
+
+// Values out of range in an otherwise well sized image are rejected; then
+// every byte in turn is set to 0x7f and 0xff, the tracker must either
+// reject the image or keep tracking with it.
+static bool check_damage(const ReidTracker::SpecifiedCfg &linear,
+                         const ReidTracker::SpecifiedCfg &kalman) {
+  auto image = one_track(linear);
+  size_t window = image.size() - kFilter + 28;
+  size_t slot = image.size() - kFilter - kSlot;
+  double step = 0.f;
+  int size = 0;
+  if (image.size() > kFilter + kSlot) {
+    memcpy(&step, &image[window + 208], sizeof(step));
+    memcpy(&size, &image[window + 196], sizeof(size));
+  }
+  if (step != double(0.050f - 0.000f) || size < 1 || size > 3 ||
+      image[slot - 1] != 1 || image[slot - 2] != 1) {
+    cout << "snapshot layout changed, update the offsets" << endl;
+    return false;
+  }
+  bool rejected = restore(linear, image);
+  rejected = rejected && !restore(linear, with(image, window + 192, -1));
+  rejected = rejected && !restore(linear, with(image, window + 196, 1 << 30));
+  rejected = rejected && !restore(linear, with(image, window + 200, 1000000));
+  rejected = rejected && !restore(linear, with(image, window + 208, 1e300));
+  rejected = rejected && !restore(linear, with<char>(image, slot - 1, 0x7f));
+  rejected = rejected && !restore(linear, with<char>(image, slot - 2, 0x7f));
+  rejected = rejected && !restore(linear, with<char>(image, slot - 11, 0x7f));
+  rejected = rejected && !restore(linear, with(image, slot - 10, 5));
+  rejected = rejected && !restore(linear, with(image, slot - 15, -1));
+  auto kalman_image = one_track(kalman);
+  size_t state = kalman_image.size() - kTrack - kKalmanState;
+  rejected = rejected && restore(kalman, kalman_image);
+  rejected = rejected &&
+             !restore(kalman, with(kalman_image, state,
+                                   numeric_limits<float>::quiet_NaN()));
+  rejected = rejected &&
+             !restore(kalman, with(kalman_image, state + 4 * 7 + 8,
+                                   numeric_limits<float>::infinity()));
+  cout << "damaged fields " << (rejected ? "rejected" : "ACCEPTED") << endl;
+  int accepted = 0;
+  for (auto *base : {&image, &kalman_image}) {
+    auto &cfg = base == &image ? linear : kalman;
+    for (size_t k = 0; k < base->size(); ++k) {
+      for (char value : {(char)0x7f, (char)0xff}) {
+        if ((*base)[k] == value) continue;
+        accepted += restore(cfg, with(*base, k, value));
+      }
+    }
+  }
+  cout << "single byte damage: " << accepted << " images tracked on" << endl;
+  return rejected;
+}
+
+int main(int argc, char **argv) {
+  // the damage offsets assume float features and one exemplar
+  setenv("REID_TRACKER_FEAT_BITS", "32", 1);
+  setenv("REID_TRACKER_EXEMPLARS", "1", 1);
+  ReidTracker::SpecifiedCfg linear(array<int, 4>({3, 3, 1, 1}),
+                                   array<int, 3>({3, 2, 1}));
+  ReidTracker::SpecifiedCfg kalman(array<int, 4>({0, 0, 0, 0}),
+                                   array<int, 3>({3, 2, 1}));
+  bool ok = check(linear, "linear");
+  ok = check(kalman, "kalman") && ok;
+
+  // damaged images are rejected and leave the tracker empty
+  FILE *fp = fopen(kPath, "rb");
+  vector<char> image(1 << 20);
+  image.resize(fread(image.data(), 1, image.size(), fp));
+  fclose(fp);
+  fp = fopen(kPath, "wb");
+  fwrite(image.data(), 1, image.size() / 2, fp);
+  fclose(fp);
+  auto truncated = ReidTracker::create(0, kalman);
+  bool rejected = !truncated->restoreSnapshot(kPath);
+  auto wrong_model = ReidTracker::create(0, linear);
+  fp = fopen(kPath, "wb");
+  fwrite(image.data(), 1, image.size(), fp);
+  fclose(fp);
+  rejected = rejected && !wrong_model->restoreSnapshot(kPath);
+  rejected = rejected && !truncated->restoreSnapshot("missing_snapshot.bin");
+  Outputs output;
+  truncated->track(1, nullptr, 0, true, true, output);
+  rejected = rejected && output.empty();
+  cout << "damaged images " << (rejected ? "rejected" : "ACCEPTED") << endl;
+  ok = ok && rejected;
+  ok = check_damage(linear, kalman) && ok;
+  remove(kPath);
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <map>
+#include <random>
+
+#include "../src/state_map.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// Random transitions on the window and on a plain map of the same frames;
+// the current id must always be the lowest frame in a good state.
+int main(int argc, char **argv) {
+  mt19937 gen(3);
+  StateMap sm(64);
+  sm.addBadState(StateMap::DET_TO);
+  sm.addBadState(StateMap::TRC_ED);
+  auto is_bad = [](StateMap::State s) {
+    return s == StateMap::DET_TO || s == StateMap::TRC_ED;
+  };
+  map<int, StateMap::State> ref;
+  int next_id = 0, errors = 0, steps = 200000;
+  for (int step = 0; step < steps; ++step) {
+    int op = gen() % 10;
+    if (op < 3 && (ref.empty() || next_id - ref.begin()->first < 60)) {
+      bool added = sm.add(next_id, StateMap::DET_ST);
+      if (added) ref[next_id] = StateMap::DET_ST;
+      errors += !added;
+      next_id++;
+    } else if (op < 9 && !ref.empty()) {
+      auto it = ref.begin();
+      advance(it, gen() % ref.size());
+      auto state = StateMap::State(1 + gen() % 5);
+      errors += !sm.set(it->first, state);
+      it->second = state;
+    } else {
+      sm.clearBadStates();
+      for (auto it = ref.begin(); it != ref.end();)
+        it = is_bad(it->second) ? ref.erase(it) : next(it);
+    }
+    int cur = -1;
+    for (auto &e : ref) {
+      if (!is_bad(e.second)) {
+        cur = e.first;
+        break;
+      }
+    }
+    errors += sm.getCurId() != cur;
+    if (cur >= 0) errors += sm.getCurState() != ref[cur];
+  }
+  // a frame whose slot is still taken is refused
+  StateMap small(4);
+  bool ok = errors == 0 && small.add(1, StateMap::DET_ST) &&
+            !small.add(5, StateMap::DET_ST) && small.add(4, StateMap::DET_ST);
+  cout << steps << " transitions, " << errors << " errors" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+
+using namespace std;
+using namespace vitis::ai;
+
+typedef ReidTracker::TrackEvent TrackEvent;
+
+// Three objects: a is always seen, b misses frames 20 to 29 and comes back,
+// c leaves at frame 30. The events are drained by another thread while
+// tracking and must tell each story in order; the REMOVED events must match
+// GetRemoveID.
+int main(int argc, char **argv) {
+  int dim = 128, frames = 120;
+  mt19937 gen(0);
+  normal_distribution<float> noise(0.f, 1.f);
+  vector<vector<float>> feats(3, vector<float>(dim));
+  for (auto &f : feats) {
+    double norm = 0;
+    for (auto &x : f) {
+      x = noise(gen);
+      norm += x * x;
+    }
+    for (auto &x : f) x /= sqrt(norm);
+  }
+  vector<cv::Rect_<float>> boxes{{0.1f, 0.2f, 0.05f, 0.12f},
+                                 {0.4f, 0.2f, 0.05f, 0.12f},
+                                 {0.7f, 0.2f, 0.05f, 0.12f}};
+
+  auto tracker = ReidTracker::create();
+  atomic<bool> done(false);
+  vector<TrackEvent> events;
+  thread consumer([&] {
+    TrackEvent batch[4];
+    for (;;) {
+      bool last = done.load();
+      size_t n;
+      while ((n = tracker->PopEvents(batch, 4)) > 0)
+        events.insert(events.end(), batch, batch + n);
+      if (last) break;
+      this_thread::yield();
+    }
+  });
+
+  vector<ReidTracker::Detection> detections;
+  vector<ReidTracker::OutputCharact> output;
+  map<uint64_t, uint64_t> removed;  // gid -> frame, from GetRemoveID
+  map<int, uint64_t> gid_of;        // object -> gid, from the output
+  for (int f = 1; f <= frames; ++f) {
+    detections.clear();
+    for (int o = 0; o < 3; ++o) {
+      if (o == 1 && f >= 20 && f < 30) continue;
+      if (o == 2 && f >= 30) continue;
+      boxes[o].x += 0.001f;
+      detections.push_back({feats[o].data(), dim, boxes[o], 0.9f, 1, o});
+    }
+    tracker->track(f, detections.data(), detections.size(), true, true,
+                   output);
+    for (auto &out : output) gid_of[get<4>(out)] = get<0>(out);
+    for (int gid : tracker->GetRemoveID()) removed[gid] = f;
+  }
+  done = true;
+  consumer.join();
+  uint64_t dropped = 1;
+  TrackEvent rest;
+  tracker->PopEvents(&rest, 1, &dropped);
+
+  // per gid, the sequence of event types
+  map<uint64_t, vector<int>> story;
+  map<uint64_t, uint64_t> removed_events;
+  uint64_t last_frame = 0;
+  bool ok = dropped == 0 && gid_of.size() == 3;
+  for (auto &e : events) {
+    ok = ok && e.frame_id >= last_frame;
+    last_frame = e.frame_id;
+    if (e.gid == 0) continue;  // CREATED, before the gid is known
+    story[e.gid].push_back(e.type);
+    if (e.type == TrackEvent::REMOVED) removed_events[e.gid] = e.frame_id;
+  }
+  vector<int> seen{TrackEvent::CONFIRMED};
+  vector<int> back{TrackEvent::CONFIRMED, TrackEvent::LOST,
+                   TrackEvent::REIDENTIFIED};
+  vector<int> gone{TrackEvent::CONFIRMED, TrackEvent::LOST,
+                   TrackEvent::REMOVED};
+  ok = ok && story[gid_of[0]] == seen && story[gid_of[1]] == back &&
+       story[gid_of[2]] == gone && removed == removed_events;
+  cout << events.size() << " events, " << removed.size() << " removed, "
+       << dropped << " dropped" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+
+using namespace std;
+using namespace vitis::ai;
+
+// Detector threads finish their frames out of order; the track lock must
+// still hand over in frame order, skipping the frames whose detection
+// timed out, and every waiter must get the lock well before the timeout.
+int main(int argc, char **argv) {
+  int nthread = 4, frames = 400, timed_out = 50, dim = 64;
+  auto tracker = ReidTracker::create(ReidTracker::MODE_MULTIDETS);
+  for (int f = 1; f <= frames; ++f) tracker->addDetStart(f);
+
+  atomic<int> next(1);
+  mutex mtx;
+  vector<int> order;
+  bool locked_ok = true;
+  vector<thread> detectors;
+  for (int t = 0; t < nthread; ++t) {
+    detectors.emplace_back([&, t] {
+      mt19937 gen(t);
+      uniform_int_distribution<int> latency(0, 800);
+      cv::Mat feat(1, dim, 0);
+      for (int k = 0; k < dim; ++k) feat.at<float>(0, k) = k == t ? 1.f : 0.f;
+      for (int f; (f = next++) <= frames;) {
+        this_thread::sleep_for(chrono::microseconds(latency(gen)));
+        if (f == timed_out) {
+          tracker->setDetTimeout(f);
+          continue;
+        }
+        tracker->setDetEnd(f);
+        if (!tracker->setTrackLock(f, 5000)) {
+          lock_guard<mutex> lock(mtx);
+          locked_ok = false;
+          continue;
+        }
+        {
+          lock_guard<mutex> lock(mtx);
+          order.push_back(f);
+        }
+        vector<ReidTracker::InputCharact> input{ReidTracker::InputCharact(
+            feat, cv::Rect_<float>(0.1f + 0.001f * f, 0.2f, 0.05f, 0.1f),
+            0.9f, 1, 0)};
+        tracker->trackWithoutLock(f, input);
+        tracker->releaseTrackLock(f);
+      }
+    });
+  }
+  for (auto &d : detectors) d.join();
+
+  bool ok = locked_ok && (int)order.size() == frames - 1;
+  for (size_t k = 1; ok && k < order.size(); ++k) ok = order[k] > order[k - 1];
+  auto stats = tracker->getTrackLockStats();
+  ok = ok && stats.acquired == (uint64_t)frames - 1 && stats.timeouts == 0 &&
+       stats.wait_max < 1e6;
+  cout << stats.acquired << " acquired, " << stats.contended
+       << " contended, wait avg " << stats.wait_avg << " max "
+       << stats.wait_max << " us, " << stats.timeouts << " timeouts" << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+#include "walk_scene.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// Tracks several streams through one manager, from one thread per stream
+// and, for the last stream, by queueing every frame before waiting. Each
+// stream must give what a tracker of its own gives.
+int main(int argc, char **argv) {
+  int nstream = 6, nframe = 150;
+  vector<WalkFrames> streams;
+  for (int s = 0; s < nstream; ++s) {
+    WalkOptions options;
+    options.seed = s;
+    WalkScene walk(4 + s % 3, options);
+    streams.emplace_back(walk, nframe);
+  }
+
+  vector<vector<Outputs>> expected(nstream, vector<Outputs>(nframe));
+  for (int s = 0; s < nstream; ++s) {
+    auto tracker = ReidTracker::create();
+    for (int f = 0; f < nframe; ++f) {
+      auto &dets = streams[s].frames[f];
+      tracker->track(f + 1, dets.data(), dets.size(), true, true,
+                     expected[s][f]);
+    }
+  }
+
+  auto manager = ReidTrackerManager::create(4);
+  vector<vector<Outputs>> got(nstream, vector<Outputs>(nframe));
+  vector<bool> in_order(nstream, true);
+  vector<thread> cameras;
+  for (int s = 0; s < nstream - 1; ++s) {
+    cameras.emplace_back([&, s] {
+      for (int f = 0; f < nframe; ++f) {
+        auto &dets = streams[s].frames[f];
+        uint64_t frame_id = manager
+                                ->track(s, dets.data(), dets.size(), true,
+                                        true, got[s][f])
+                                .get();
+        if (frame_id != (uint64_t)f + 1) in_order[s] = false;
+      }
+    });
+  }
+  int last = nstream - 1;
+  vector<future<uint64_t>> queued;
+  for (int f = 0; f < nframe; ++f) {
+    auto &dets = streams[last].frames[f];
+    queued.push_back(manager->track(last, dets.data(), dets.size(), true, true,
+                                    got[last][f]));
+  }
+  for (int f = 0; f < nframe; ++f)
+    if (queued[f].get() != (uint64_t)f + 1) in_order[last] = false;
+  for (auto &camera : cameras) camera.join();
+
+  bool ok = true;
+  for (int s = 0; s < nstream; ++s) {
+    int mismatch = 0;
+    for (int f = 0; f < nframe; ++f)
+      mismatch += !SameOutputs(expected[s][f], got[s][f]);
+    auto stats = manager->stats(s);
+    bool stream_ok = mismatch == 0 && in_order[s] &&
+                     stats.frames == (uint64_t)nframe && stats.pending == 0;
+    cout << "stream " << s << ": " << stats.frames << " updates, queue avg "
+         << stats.queue_avg << " max " << stats.queue_max
+         << " us, update avg " << stats.update_avg << " max "
+         << stats.update_max << " us, " << mismatch << " mismatches "
+         << (stream_ok ? "ok" : "FAILED") << endl;
+    ok = ok && stream_ok;
+  }
+  ok = ok && manager->removeStream(0) && !manager->removeStream(0) &&
+       manager->stats(0).frames == 0;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
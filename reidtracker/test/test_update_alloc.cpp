@@ -0,0 +1,122 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+#include "../src/ftd/ftd_structure.hpp"
+
+using namespace std;
+using namespace vitis::ai;
+
+// count heap allocations made by FTD_Structure::Update, and by the span based
+// ReidTracker::track, which must produce the same results; every output of
+// the latter must also be found through the result of its detection. With
+// REID_TRACKER_GATE set the per-component blocks still grow whenever a
+// larger cluster than ever before forms, so run this with the default
+// (dense) association.
+static atomic<long> alloc_count(0);
+void *operator new(size_t size) {
+  alloc_count++;
+  void *p = malloc(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main(int argc, char **argv) {
+  int nobj = argc > 1 ? atoi(argv[1]) : 30;
+  int frames = argc > 2 ? atoi(argv[2]) : 100;
+  int warmup = 10;
+  int dim = 128;
+  mt19937 gen(0);
+  uniform_real_distribution<float> pos(0.f, 0.8f);
+  normal_distribution<float> noise(0.f, 1.f);
+
+  // one persistent input vector, boxes are moved in place every frame so
+  // the test itself does not allocate inside the measured loop
+  vector<InputCharact> input;
+  vector<array<float, 2>> speed;
+  for (int i = 0; i < nobj; ++i) {
+    Mat feat(1, dim, CV_32F);
+    double norm = 0;
+    for (int k = 0; k < dim; ++k) {
+      feat.at<float>(0, k) = noise(gen);
+      norm += feat.at<float>(0, k) * feat.at<float>(0, k);
+    }
+    for (int k = 0; k < dim; ++k) feat.at<float>(0, k) /= sqrt(norm);
+    input.emplace_back(feat, Rect_<float>(pos(gen), pos(gen), 0.04f, 0.1f),
+                       0.9f, 1, i);
+    speed.push_back({noise(gen) * 0.001f, noise(gen) * 0.001f});
+  }
+
+  // the records borrow the features of input
+  vector<ReidTracker::Detection> records;
+  for (auto &in : input)
+    records.push_back({get<0>(in).ptr<float>(0), dim, get<1>(in), get<2>(in),
+                       get<3>(in), get<4>(in)});
+
+  SpecifiedCfg cfg{{3, 3, 1, 1}, {0, 0, 0}};
+  FTD_Structure ftd(cfg);
+  auto tracker = ReidTracker::create(0, cfg);
+  vector<OutputCharact> output, span_output;
+  vector<ReidTracker::DetectionResult> results(records.size());
+  long steady = 0, span_steady = 0;
+  bool same = true, found = true;
+  for (int f = 1; f <= warmup + frames; ++f) {
+    for (int i = 0; i < nobj; ++i) {
+      auto &box = get<1>(input[i]);
+      box.x += speed[i][0];
+      box.y += speed[i][1];
+      records[i].bbox = box;
+    }
+    long before = alloc_count;
+    ftd.Update(f, true, 1, input, output);
+    long middle = alloc_count;
+    tracker->track(f, records.data(), records.size(), true, true,
+                   span_output, results.data());
+    if (f > warmup) {
+      steady += middle - before;
+      span_steady += alloc_count - middle;
+    }
+    same = same && output == span_output;
+    size_t tracked = 0;
+    for (size_t k = 0; k < records.size(); ++k) {
+      if (results[k].state != ReidTracker::DetectionResult::TRACKED) continue;
+      tracked++;
+      bool match = false;
+      for (auto &out : span_output)
+        match = match || (get<0>(out) == results[k].gid &&
+                          get<1>(out) == results[k].bbox &&
+                          get<4>(out) == records[k].local_id);
+      found = found && match;
+    }
+    found = found && tracked == span_output.size();
+  }
+  cout << output.size() << " tracks, " << steady << " allocations in "
+       << frames << " steady-state updates, " << span_steady
+       << " through the span api, results "
+       << (same ? "same" : "DIFFERENT") << ", detection results "
+       << (found ? "match" : "DO NOT MATCH") << endl;
+  return steady == 0 && span_steady == 0 && same && found ? 0 : 1;
+}
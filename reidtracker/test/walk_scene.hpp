@@ -0,0 +1,186 @@
+/*
+ * Copyright 2019 Xilinx Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _WALK_SCENE_HPP_
+#define _WALK_SCENE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <opencv2/core.hpp>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <vitis/ai/reidtracker.hpp>
+
+// Simulated walkers shared by the tracker tests.
+//
+// Every object has a unit feature of its own and walks at a constant
+// velocity, turning back at the edges of the frame. A detection carries the
+// feature with some noise, scaled to unit norm again, and the object index
+// as local id; with probability miss an object is not detected in a frame.
+struct WalkOptions {
+  int dim = 128;
+  unsigned seed = 0;
+  // standard deviation of the velocity per frame, and of the feature noise
+  // relative to the unit feature
+  float speed = 0.002f;
+  float feat_noise = 0.f;
+  float miss = 0.1f;
+  float width = 0.04f;
+  float height = 0.1f;
+};
+
+class WalkScene {
+ public:
+  explicit WalkScene(int nobj, const WalkOptions &options = WalkOptions())
+      : options_(options), gen_(options.seed) {
+    std::normal_distribution<float> noise(0.f, 1.f);
+    std::uniform_real_distribution<float> pos(0.05f, 0.8f);
+    for (int o = 0; o < nobj; ++o) {
+      std::vector<float> feat(options_.dim);
+      for (auto &x : feat) x = noise(gen_);
+      Normalize(feat);
+      feats_.push_back(feat);
+      boxes_.emplace_back(pos(gen_), pos(gen_), options_.width,
+                          options_.height);
+      speed_.push_back({noise(gen_) * options_.speed,
+                        noise(gen_) * options_.speed});
+    }
+    seen_.assign(nobj, std::vector<float>(options_.dim));
+  }
+
+  int dim() const { return options_.dim; }
+  int objects() const { return feats_.size(); }
+
+  // Moves every object by one frame and detects it.
+  void Next() {
+    std::normal_distribution<float> noise(0.f, 1.f);
+    std::uniform_real_distribution<float> uniform(0.f, 1.f);
+    detections_.clear();
+    for (size_t o = 0; o < boxes_.size(); ++o) {
+      auto &box = boxes_[o];
+      box.x += speed_[o][0];
+      box.y += speed_[o][1];
+      if (box.x < 0.f || box.x + box.width > 1.f) speed_[o][0] *= -1.f;
+      if (box.y < 0.f || box.y + box.height > 1.f) speed_[o][1] *= -1.f;
+      if (uniform(gen_) < options_.miss) continue;
+      auto &feat = seen_[o];
+      feat = feats_[o];
+      if (options_.feat_noise > 0.f) {
+        float scale = options_.feat_noise / std::sqrt((float)options_.dim);
+        for (auto &x : feat) x += scale * noise(gen_);
+        Normalize(feat);
+      }
+      detections_.push_back(
+          {feat.data(), options_.dim, box, 0.9f, 1, (int)o});
+    }
+  }
+  // The detections of the last Next, valid until the next one.
+  const std::vector<vitis::ai::ReidTracker::Detection> &detections() const {
+    return detections_;
+  }
+
+ private:
+  static void Normalize(std::vector<float> &feat) {
+    double norm = 0;
+    for (auto x : feat) norm += x * x;
+    for (auto &x : feat) x /= std::sqrt(norm);
+  }
+
+  WalkOptions options_;
+  std::mt19937 gen_;
+  std::vector<std::vector<float>> feats_;
+  std::vector<std::vector<float>> seen_;
+  std::vector<cv::Rect_<float>> boxes_;
+  std::vector<std::array<float, 2>> speed_;
+  std::vector<vitis::ai::ReidTracker::Detection> detections_;
+};
+
+// The detections of nframe frames of a scene, kept with their features so
+// that the frames can be tracked in any order and from any thread.
+struct WalkFrames {
+  WalkFrames(WalkScene &scene, int nframe) : feats(nframe), frames(nframe) {
+    for (int f = 0; f < nframe; ++f) {
+      scene.Next();
+      auto &dets = scene.detections();
+      feats[f].resize(dets.size() * scene.dim());
+      for (size_t k = 0; k < dets.size(); ++k) {
+        float *feat = &feats[f][k * scene.dim()];
+        std::copy(dets[k].feat, dets[k].feat + scene.dim(), feat);
+        frames[f].push_back(dets[k]);
+        frames[f].back().feat = feat;
+      }
+    }
+  }
+  // the detections point into feats, which a move keeps but a copy not
+  WalkFrames(const WalkFrames &) = delete;
+  WalkFrames(WalkFrames &&) = default;
+  int size() const { return frames.size(); }
+  // Frame f as InputCharact records, the Mats share the stored features.
+  std::vector<vitis::ai::ReidTracker::InputCharact> Input(int f) const {
+    std::vector<vitis::ai::ReidTracker::InputCharact> input;
+    for (auto &d : frames[f]) {
+      cv::Mat feat(1, d.feat_dim, CV_32F, (void *)d.feat);
+      input.emplace_back(feat, d.bbox, d.score, d.label, d.local_id);
+    }
+    return input;
+  }
+
+  std::vector<std::vector<float>> feats;
+  std::vector<std::vector<vitis::ai::ReidTracker::Detection>> frames;
+};
+
+typedef std::vector<vitis::ai::ReidTracker::OutputCharact> Outputs;
+
+// Same tracks (gid, box, score, label and local id) in the same order.
+inline bool SameOutputs(const Outputs &a, const Outputs &b) {
+  if (a.size() != b.size()) return false;
+  for (size_t k = 0; k < a.size(); ++k) {
+    if (std::get<0>(a[k]) != std::get<0>(b[k]) ||
+        !(std::get<1>(a[k]) == std::get<1>(b[k])) ||
+        std::get<2>(a[k]) != std::get<2>(b[k]) ||
+        std::get<3>(a[k]) != std::get<3>(b[k]) ||
+        std::get<4>(a[k]) != std::get<4>(b[k]))
+      return false;
+  }
+  return true;
+}
+
+// Folds what SameOutputs compares into hash (FNV-1a, start from
+// kOutputsHash), for outputs compared across processes.
+const uint64_t kOutputsHash = 1469598103934665603ull;
+inline void HashOutputs(uint64_t &hash, const Outputs &outputs) {
+  auto mix = [&hash](uint64_t v) { hash = (hash ^ v) * 1099511628211ull; };
+  auto mix_float = [&mix](float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    mix(bits);
+  };
+  for (auto &out : outputs) {
+    auto &box = std::get<1>(out);
+    mix(std::get<0>(out));
+    for (float v : {box.x, box.y, box.width, box.height}) mix_float(v);
+    mix_float(std::get<2>(out));
+    mix(std::get<3>(out));
+    mix(std::get<4>(out));
+  }
+}
+
+#endif
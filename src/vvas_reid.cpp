@@ -27,6 +27,9 @@
 #include <vitis/ai/reid.hpp>
 #include <vitis/ai/reidtracker.hpp>
 #include "common.hpp"
+#include <atomic>
+#include <mutex>
+#include <new>
 #include <sstream>
 
 #define MAX_REID 20
@@ -34,6 +37,7 @@
 #define DEFAULT_REID_DEBUG     0
 #define DEFAULT_MODEL_NAME     "personreid-res18_pt"
 #define DEFAULT_MODEL_PATH     "/opt/xilinx/kv260-aibox-reid/share/vitis_ai_library/models"
+#define DEFAULT_SNAPSHOT_PERIOD 300
 
 using namespace std;
 
@@ -51,7 +55,16 @@ typedef struct _kern_priv {
   std::string modelpath;
   std::string modelname;
   std::shared_ptr<vitis::ai::Reid> det;
+  /* the trackers of all instances share one manager and its workers */
+  std::shared_ptr<vitis::ai::ReidTrackerManager> manager;
+  int stream_id;
+  int frame_num;
   std::shared_ptr<vitis::ai::ReidTracker> tracker;
+  /* per frame buffers, reused */
+  std::vector<cv::Mat> feats;
+  std::vector<vitis::ai::ReidTracker::Detection> detections;
+  std::vector<vitis::ai::ReidTracker::OutputCharact> track_results;
+  std::vector<vitis::ai::ReidTracker::DetectionResult> detection_results;
 } ReidKernelPriv;
 
 struct _roi {
@@ -118,14 +131,27 @@ static int parse_rect(VVASKernel * handle, int start,
     return 0;
 }
 
+/* one manager per process, alive while some kernel instance uses it */
+static std::shared_ptr<vitis::ai::ReidTrackerManager> get_manager() {
+  static std::mutex mtx;
+  static std::weak_ptr<vitis::ai::ReidTrackerManager> shared;
+  std::lock_guard<std::mutex> lock(mtx);
+  auto manager = shared.lock();
+  if (!manager) {
+    manager = vitis::ai::ReidTrackerManager::create();
+    shared = manager;
+  }
+  return manager;
+}
+
 extern "C" {
 int32_t xlnx_kernel_init(VVASKernel *handle) {
   json_t *jconfig = handle->kernel_config;
   json_t *val; /* kernel config from app */
 
   handle->is_multiprocess = 1;
-  ReidKernelPriv *kernel_priv =
-      (ReidKernelPriv *)calloc(1, sizeof(ReidKernelPriv));
+  /* value initialized, the members need their constructors */
+  ReidKernelPriv *kernel_priv = new (std::nothrow) ReidKernelPriv();
   if (!kernel_priv) {
     printf("Error: Unable to allocate reID kernel memory\n");
   }
@@ -160,7 +186,30 @@ int32_t xlnx_kernel_init(VVASKernel *handle) {
   if (kernel_priv->det.get() == NULL) {
     printf("Error: Unable to create Reid runner with model %s.\n", xmodelfile.c_str());
   }
-  kernel_priv->tracker = vitis::ai::ReidTracker::create();
+  /* stream-id keys the tracker of this instance, by default each instance
+   * gets its own */
+  static std::atomic<int> next_stream_id(1 << 16);
+  val = json_object_get(jconfig, "stream-id");
+  if (!val || !json_is_number(val))
+    kernel_priv->stream_id = next_stream_id++;
+  else
+    kernel_priv->stream_id = json_number_value(val);
+  kernel_priv->manager = get_manager();
+  kernel_priv->tracker = kernel_priv->manager->tracker(kernel_priv->stream_id);
+
+  /* optional warm restart: resume from the last snapshot, then keep one
+   * written every snapshot-period frames */
+  val = json_object_get(jconfig, "snapshot-path");
+  if (val && json_is_string (val) && kernel_priv->tracker.get()) {
+    std::string snapshot = json_string_value (val);
+    int period = DEFAULT_SNAPSHOT_PERIOD;
+    json_t *pval = json_object_get(jconfig, "snapshot-period");
+    if (pval && json_is_number(pval))
+      period = json_number_value(pval);
+    if (kernel_priv->tracker->restoreSnapshot(snapshot))
+      printf("VVAS REID: tracker state restored from %s\n", snapshot.c_str());
+    kernel_priv->tracker->setSnapshot(snapshot, period);
+  }
 
   handle->kernel_priv = (void *)kernel_priv;
   return 0;
@@ -168,7 +217,8 @@ int32_t xlnx_kernel_init(VVASKernel *handle) {
 
 uint32_t xlnx_kernel_deinit(VVASKernel *handle) {
   ReidKernelPriv *kernel_priv = (ReidKernelPriv *)handle->kernel_priv;
-  free(kernel_priv);
+  kernel_priv->manager->removeStream(kernel_priv->stream_id);
+  delete kernel_priv;
   return 0;
 }
 
@@ -181,9 +231,11 @@ int32_t xlnx_kernel_start(VVASKernel *handle, int start /*unused */,
     return 1;
   }
 
-  static int frame_num = 0;
-  frame_num++;
-  std::vector<vitis::ai::ReidTracker::InputCharact> input_characts;
+  int frame_num = ++kernel_priv->frame_num;
+  auto &feats = kernel_priv->feats;
+  auto &detections = kernel_priv->detections;
+  feats.clear();
+  detections.clear();
   /* get metadata from input */
 
   vvas_ms_roi roi_data;
@@ -209,10 +261,13 @@ int32_t xlnx_kernel_start(VVASKernel *handle, int start /*unused */,
             cv::Rect2f(roi.x_cord, roi.y_cord,
                        roi.width, roi.height);
         m__TIC__(reidrun);
-        auto feat = kernel_priv->det->run(image).feat;
+        feats.push_back(kernel_priv->det->run(image).feat);
         m__TOC__(reidrun);
         m__TIC__(inputpush);
-        input_characts.emplace_back(feat, input_box, roi.prob, -1, i);
+        /* the tracker borrows the feature, feats keeps it alive */
+        const cv::Mat &feat = feats.back();
+        detections.push_back({feat.ptr<float>(0), feat.cols, input_box,
+                              (float)roi.prob, -1, (int)i});
         m__TOC__(inputpush);
         if (kernel_priv->debug == 2) {
             printf("Tracker input: Frame %d: obj_ind %d, xmin %u, ymin %u, xmax %u, ymax %u, prob: %f\n",
@@ -228,20 +283,38 @@ int32_t xlnx_kernel_start(VVASKernel *handle, int start /*unused */,
     }
   }
   m__TOC__(getfeat);
-  if (input_characts.size() > 0)
+  if (detections.size() > 0)
   {
-  std::vector<vitis::ai::ReidTracker::OutputCharact> track_results =
-      std::vector<vitis::ai::ReidTracker::OutputCharact>(
-          kernel_priv->tracker->track(frame_num, input_characts, true, true));
+  auto &track_results = kernel_priv->track_results;
+  auto &detection_results = kernel_priv->detection_results;
+  detection_results.resize(detections.size());
+  kernel_priv->manager
+      ->track(kernel_priv->stream_id, detections.data(), detections.size(),
+              true, true, track_results, detection_results.data())
+      .get();
   if (kernel_priv->debug) {
       printf("Tracker result: \n");
   }
-  int i = 0;
-  for (auto &r : track_results) {
-    auto box = get<1>(r);
-    gint tmpx = box.x, tmpy = box.y;
-    guint tmpw = box.width, tmph = box.height;
-    uint64_t gid = get<0>(r);
+  if (kernel_priv->debug && frame_num % 100 == 0) {
+    auto stats = kernel_priv->manager->stats(kernel_priv->stream_id);
+    printf("Tracker stream %d: %" PRIu64 " updates, queue avg %.0f max %.0f us,"
+           " update avg %.0f max %.0f us\n", kernel_priv->stream_id,
+           stats.frames, stats.queue_avg, stats.queue_max, stats.update_avg,
+           stats.update_max);
+  }
+  /* rois without a tracked detection are marked as not tracked */
+  for (uint32_t i = 0; i < roi_data.nobj; i++)
+  {
+    roi_data.roi[i].prediction->reserved_2 = (void*)-1;
+  }
+  /* result k belongs to detection k, whose local_id is its roi index */
+  for (size_t k = 0; k < detections.size(); k++) {
+    auto &r = detection_results[k];
+    if (r.state != vitis::ai::ReidTracker::DetectionResult::TRACKED)
+      continue;
+    gint tmpx = r.bbox.x, tmpy = r.bbox.y;
+    guint tmpw = r.bbox.width, tmph = r.bbox.height;
+    uint64_t gid = r.gid;
     if (kernel_priv->debug) {
       printf("Frame %d: %" PRIu64 ", xmin %d, ymin %d, w %u, h %u\n",
          frame_num, gid,
@@ -249,20 +322,13 @@ int32_t xlnx_kernel_start(VVASKernel *handle, int start /*unused */,
          tmpw, tmph);
     }
 
-    struct _roi& roi = roi_data.roi[i];
-    roi_data.roi[i].prediction->bbox.x = tmpx;
-    roi_data.roi[i].prediction->bbox.y = tmpy;
-    roi_data.roi[i].prediction->bbox.width = tmpw;
-    roi_data.roi[i].prediction->bbox.height = tmph;
-    roi_data.roi[i].prediction->reserved_1 = (void*)gid;
-    roi_data.roi[i].prediction->reserved_2 = (void*)1;
-
-    i++;
-  }
-
-  for (; i < roi_data.nobj; i++)
-  {
-    roi_data.roi[i].prediction->reserved_2 = (void*)-1;
+    struct _roi& roi = roi_data.roi[detections[k].local_id];
+    roi.prediction->bbox.x = tmpx;
+    roi.prediction->bbox.y = tmpy;
+    roi.prediction->bbox.width = tmpw;
+    roi.prediction->bbox.height = tmph;
+    roi.prediction->reserved_1 = (void*)gid;
+    roi.prediction->reserved_2 = (void*)1;
   }
   }
   return 0;